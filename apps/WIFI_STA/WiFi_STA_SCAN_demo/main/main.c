@@ -3,13 +3,19 @@
 #include "esp_netif.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
-#include "nvs_flash.h"
-
+#include "bootstrap.h"
 #include "wifi_sta.h"
+#include "wifi_sta_http.h"
+#include "wifi_sta_scan_sched.h"
 
 // Settings
-static const uint32_t sleep_time_ms = 5000;
+static const uint16_t max_shown_ap = 10;
+
 
+static esp_err_t http_step (void *arg)
+{
+    return wifi_sta_http_start();
+}
 
 // App entrypoint
 
@@ -20,33 +26,22 @@ void app_main (void)
     // Initialize event group
     network_event_group = xEventGroupCreate();
 
-    // Initialize NVS: ESP32 WiFi driver uses NVS to store WiFi settings
-    esp_ret = nvs_flash_init();
-    if (esp_ret == ESP_ERR_NVS_NO_FREE_PAGES || esp_ret == ESP_ERR_NVS_NEW_VERSION_FOUND){
-        ESP_ERROR_CHECK (nvs_flash_erase());
-        esp_ret = nvs_flash_init();
-    }
-    if (esp_ret != ESP_OK){
-        perror ("ERROR (%d): Failed to initialize NVS");
-        abort();
-    }
-
-    // (s1.3) Create default event loop that runs in the background
-    // Must be running prior to initializing the network driver!
-    esp_ret = esp_event_loop_create_default();
-    if (esp_ret != ESP_OK) {
-        perror ("Error (%d): Failed to create default event loop");
-        abort();
-    }
-
-    // Initialize network connection (wifi_sta.h)
-    esp_ret = wifi_sta_init(network_event_group);
+    // Bring up WiFi, then the HTTP server (bootstrap.h)
+    const bootstrap_step_t steps[] = {
+        BOOTSTRAP_WIFI_STA_STEPS(network_event_group),
+        // Serve scan results as JSON (wifi_sta_http.h), needs wifi_sta_init() done
+        { .name = "http", .fn = http_step, .depends = BOOTSTRAP_DEP(BOOTSTRAP_WIFI_STA) },
+    };
+    esp_ret = bootstrap_run(steps, sizeof(steps) / sizeof(steps[0]), NULL);
     if (esp_ret != ESP_OK) {
         perror ("Error (%d): Failed to initialize WiFi");
         abort();
     }
+    // Scan period follows how much the surroundings change (wifi_sta_scan_sched.h)
+    wifi_sta_scan_sched_init(0, 0);
     wifi_sta_scan_init_default();
     wifi_sta_scan_start(); // Start scan
+    TickType_t last_scan_tick = xTaskGetTickCount();
     // Super loop
     while (1)
     {
@@ -63,15 +58,33 @@ void app_main (void)
                 perror ("Get scanned APs failed");
                 abort();
             }
-            printf ("AP\t SSID\t Auth Mode\t\n");
+            // Compare with the previous scan before filtering
+            uint32_t period_ms = wifi_sta_scan_sched_update(ap_record, ap_num);
+            printf ("Next scan in %lu ms\n", (unsigned long) period_ms);
+            // Keep the strongest BSSID of each SSID and rank by RSSI
+            wifi_sta_scan_filter_t filter = WIFI_STA_SCAN_FILTER_DEFAULT();
+            filter.dedupe_ssid = true;
+            filter.top_k = max_shown_ap;
+            wifi_sta_scan_filter(ap_record, &ap_num, &filter);
+            printf ("AP\t SSID\t RSSI\t Channel\t Auth Mode\t\n");
             for (int i=0 ; i<ap_num; i++){
                 printf ("%d\t",  i);
                 printf ("%s\t", ap_record[i].ssid);
+                printf ("%d\t", ap_record[i].rssi);
+                printf ("%d\t", ap_record[i].primary);
                 printf ("%d\t", ap_record[i].authmode);
                 printf("\n");
             }
+            // Publish the new results, the server frees them once replaced
+            if (wifi_sta_http_set_scan(ap_record, ap_num) != ESP_OK){
+                free (ap_record);
+            }
+        }
+        // Period is read every loop so a disconnect shortens the current wait
+        if (!is_wifi_sta_scan_start() &&
+            xTaskGetTickCount() - last_scan_tick >= pdMS_TO_TICKS(wifi_sta_scan_sched_get_period())){
             wifi_sta_scan_start();
-            vTaskDelay(sleep_time_ms / portTICK_PERIOD_MS);            
+            last_scan_tick = xTaskGetTickCount();
         }
         vTaskDelay(100 / portTICK_PERIOD_MS);
     }
@@ -1,11 +1,13 @@
 #include <string.h>
+#include <inttypes.h>
 #include "esp_log.h"
 #include "esp_netif.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
-#include "nvs_flash.h"
-
+#include "bootstrap.h"
 #include "wifi_sta.h"
+#include "wifi_sta_health.h"
+#include "wifi_sta_profile.h"
 
 // Settings
 static const uint64_t connect_timout_ms = 100000;
@@ -24,35 +26,11 @@ void app_main (void)
     // Initialize event group
     network_event_group = xEventGroupCreate();
 
-    // Initialize NVS: ESP32 WiFi driver uses NVS to store WiFi settings
-    esp_ret = nvs_flash_init();
-    if (esp_ret == ESP_ERR_NVS_NO_FREE_PAGES || esp_ret == ESP_ERR_NVS_NEW_VERSION_FOUND){
-        ESP_ERROR_CHECK (nvs_flash_erase());
-        esp_ret = nvs_flash_init();
-    }
-    if (esp_ret != ESP_OK){
-        ESP_LOGE (TAG, "ERROR (%d): Failed to initialize NVS", esp_ret);
-        abort();
-    }
-
-    // (s1.1) Initialize TCP/IP network interface (only call once in application)
-    // Must be called prior to initializing the network driver
-    esp_ret = esp_netif_init();
-    if (esp_ret != ESP_OK){
-        ESP_LOGE (TAG, "ERROR (%d): Failed to initialize the wifi interface",esp_ret);
-        abort();
-    }
-
-    // (s1.3) Create default event loop that runs in the background
-    // Must be running prior to initializing the network driver!
-    esp_ret = esp_event_loop_create_default();
-    if (esp_ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%d): Failed to create default event loop", esp_ret);
-        abort();
-    }
-
-    // Initialize network connection (wifi_sta.h)
-    esp_ret = wifi_sta_init(network_event_group);
+    // NVS, network interface and event loop in parallel, then WiFi (bootstrap.h)
+    const bootstrap_step_t steps[] = {
+        BOOTSTRAP_WIFI_STA_STEPS(network_event_group),
+    };
+    esp_ret = bootstrap_run(steps, sizeof(steps) / sizeof(steps[0]), NULL);
     if (esp_ret != ESP_OK) {
         ESP_LOGE(TAG, "Error (%d): Failed to initialize WiFi", esp_ret);
         abort();
@@ -86,16 +64,34 @@ void app_main (void)
         abort();
     }
 
+    // Probe the gateway and recover a dead link (wifi_sta_health.h)
+    esp_ret = wifi_sta_health_start();
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%d): Failed to start link health monitor", esp_ret);
+        abort();
+    }
+
+#if CONFIG_WIFI_STA_PROFILE_MEASURE
+    // Heap cost and receive throughput of the WiFi profile (wifi_sta_profile.h)
+    esp_ret = wifi_sta_profile_measure(CONFIG_WIFI_STA_PROFILE_MEASURE_PORT, CONFIG_WIFI_STA_PROFILE_MEASURE_MS, NULL);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGW(TAG, "Error (%d): Throughput measurement failed", esp_ret);
+    }
+#endif
+
     // Super loop
     while (1)
     {
-        // Make sure we are still connected
-        if (network_event_bits & WIFI_STA_CONNECTED_BIT){
-            ESP_LOGI (TAG, "Still connected to network");
+        // Make sure we are still connected, the health monitor recovers the link
+        wifi_sta_health_stats_t health;
+        network_event_bits = xEventGroupGetBits (network_event_group);
+        wifi_sta_health_get_stats (&health);
+        if ((network_event_bits & WIFI_STA_IPV4_OBTAINED_BIT) && health.healthy){
+            ESP_LOGI (TAG, "Still connected to network (RSSI %d dBm, RTT %" PRIu32 " ms, loss %d%%)",
+                      health.rssi_avg, health.rtt_avg_ms, health.loss_percent);
         }
         else {
-            ESP_LOGE(TAG, "Lost connection to network");
-            abort();
+            ESP_LOGW (TAG, "Link degraded or lost, waiting for recovery");
         }
 
         // Delay
@@ -0,0 +1,294 @@
+#include "bootstrap.h"
+#include "wifi_sta.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+// Tag for debug messages
+static const char* TAG = "BOOTSTRAP";
+
+// Set with all step bits on failure, so every waiter wakes up
+#define BOOTSTRAP_FAIL_BIT  BIT23
+
+typedef struct bootstrap_run bootstrap_run_t;
+
+/**
+ * @brief Argument of a step task
+ */
+typedef struct {
+    bootstrap_run_t *run;
+    uint8_t index;
+} bootstrap_task_arg_t;
+
+/**
+ * @brief State of one bootstrap_run call, freed by the last of the caller and the step tasks
+ * Steps stuck past the timeout keep using it after bootstrap_run has returned.
+ */
+struct bootstrap_run {
+    bootstrap_step_t steps[CONFIG_BOOTSTRAP_MAX_STEPS];    // Copy of the caller's array
+    bootstrap_step_time_t times[CONFIG_BOOTSTRAP_MAX_STEPS];
+    bootstrap_task_arg_t task_args[CONFIG_BOOTSTRAP_MAX_STEPS];
+    EventGroupHandle_t group;
+    SemaphoreHandle_t exit_sem;
+    EventBits_t all_bits;
+    int64_t start_us;
+    esp_err_t first_error;
+    uint8_t refs;
+};
+
+// Static global variables
+static portMUX_TYPE s_bootstrap_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************
+ * Private functions prototypes
+ */
+
+static void bootstrap_task (void *arg);
+
+static esp_err_t bootstrap_wait (bootstrap_run_t *run, EventBits_t bits, TickType_t ticks);
+
+static void bootstrap_fail (bootstrap_run_t *run, esp_err_t error);
+
+static void bootstrap_release (bootstrap_run_t *run);
+
+static void bootstrap_report (const bootstrap_run_t *run, uint8_t step_num, bootstrap_report_t *report);
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+/**
+ * @brief Run one step once its dependencies are done
+ */
+static void bootstrap_task (void *arg)
+{
+    bootstrap_run_t *run = ((bootstrap_task_arg_t*) arg)->run;
+    uint8_t index = ((bootstrap_task_arg_t*) arg)->index;
+    const bootstrap_step_t *step = &run->steps[index];
+    if (bootstrap_wait (run, step->depends, portMAX_DELAY) == ESP_OK){
+        run->times[index].start_us = (uint32_t) (esp_timer_get_time() - run->start_us);
+        esp_err_t result = step->fn (step->arg);
+        run->times[index].end_us = (uint32_t) (esp_timer_get_time() - run->start_us);
+        run->times[index].result = result;
+        if (result == ESP_OK){
+            xEventGroupSetBits (run->group, BOOTSTRAP_DEP(index));
+        }
+        else {
+            ESP_LOGE (TAG, "Step %s failed (%s)", step->name, esp_err_to_name (result));
+            bootstrap_fail (run, result);
+        }
+    }
+    xSemaphoreGive (run->exit_sem);
+    bootstrap_release (run);
+    vTaskDelete (NULL);
+}
+
+static esp_err_t bootstrap_wait (bootstrap_run_t *run, EventBits_t bits, TickType_t ticks)
+{
+    EventBits_t uxBit = xEventGroupGetBits (run->group);
+    if (bits != 0){
+        uxBit = xEventGroupWaitBits (run->group, bits, pdFALSE, pdTRUE, ticks);
+    }
+    if (uxBit & BOOTSTRAP_FAIL_BIT){
+        return ESP_FAIL;
+    }
+    return ((uxBit & bits) == bits) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+static void bootstrap_fail (bootstrap_run_t *run, esp_err_t error)
+{
+    portENTER_CRITICAL (&s_bootstrap_lock);
+    if (run->first_error == ESP_OK){
+        run->first_error = error;
+    }
+    portEXIT_CRITICAL (&s_bootstrap_lock);
+    xEventGroupSetBits (run->group, run->all_bits | BOOTSTRAP_FAIL_BIT);
+}
+
+/**
+ * @brief Drop a reference to the run state, the last one frees it
+ */
+static void bootstrap_release (bootstrap_run_t *run)
+{
+    portENTER_CRITICAL (&s_bootstrap_lock);
+    bool last = (--run->refs == 0);
+    portEXIT_CRITICAL (&s_bootstrap_lock);
+    if (last){
+        vEventGroupDelete (run->group);
+        vSemaphoreDelete (run->exit_sem);
+        free (run);
+    }
+}
+
+/**
+ * @brief Log the step timings and the critical path
+ * The critical path is the chain of dependent steps with the largest summed run time.
+ */
+static void bootstrap_report (const bootstrap_run_t *run, uint8_t step_num, bootstrap_report_t *report)
+{
+    const bootstrap_step_t *steps = run->steps;
+    const bootstrap_step_time_t *times = run->times;
+    uint32_t path_us[CONFIG_BOOTSTRAP_MAX_STEPS];
+    int8_t path_prev[CONFIG_BOOTSTRAP_MAX_STEPS];
+    uint32_t total_us = 0;
+    int8_t last = -1;
+
+    // Steps only depend on earlier ones, one pass in array order is enough
+    for (uint8_t i = 0; i < step_num; i++){
+        path_us[i] = 0;
+        path_prev[i] = -1;
+        for (uint8_t j = 0; j < i; j++){
+            if ((steps[i].depends & BOOTSTRAP_DEP(j)) && path_us[j] > path_us[i]){
+                path_us[i] = path_us[j];
+                path_prev[i] = j;
+            }
+        }
+        // Steps still running after a timeout have no end yet
+        if (times[i].end_us > times[i].start_us){
+            path_us[i] += times[i].end_us - times[i].start_us;
+        }
+        if (last < 0 || path_us[i] > path_us[last]){
+            last = i;
+        }
+        if (times[i].end_us > total_us){
+            total_us = times[i].end_us;
+        }
+        ESP_LOGI (TAG, "%-12s %8" PRIu32 " us -> %8" PRIu32 " us  %s", steps[i].name,
+                  times[i].start_us, times[i].end_us, esp_err_to_name (times[i].result));
+    }
+    uint32_t critical_steps = 0;
+    for (int8_t i = last; i >= 0; i = path_prev[i]){
+        critical_steps |= BOOTSTRAP_DEP(i);
+    }
+    uint32_t critical_path_us = last >= 0 ? path_us[last] : 0;
+    ESP_LOGI (TAG, "Total %" PRIu32 " us, critical path %" PRIu32 " us, ready %" PRId64 " us after reset",
+              total_us, critical_path_us, run->start_us + total_us);
+
+    if (report != NULL){
+        report->total_us = total_us;
+        report->critical_path_us = critical_path_us;
+        report->critical_steps = critical_steps;
+        report->ready_us = run->start_us + total_us;
+        report->step_num = step_num;
+        memcpy (report->steps, times, sizeof(times[0]) * step_num);
+    }
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+esp_err_t bootstrap_run(const bootstrap_step_t *steps, uint8_t step_num, bootstrap_report_t *report)
+{
+    if (steps == NULL || step_num == 0 || step_num > CONFIG_BOOTSTRAP_MAX_STEPS){
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint8_t i = 0; i < step_num; i++){
+        // Only earlier steps: the graph cannot have a cycle
+        if (steps[i].fn == NULL || (steps[i].depends & ~(BOOTSTRAP_DEP(i) - 1))){
+            ESP_LOGE (TAG, "Invalid step %d (%s)", i, steps[i].name ? steps[i].name : "?");
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    bootstrap_run_t *run = calloc (1, sizeof(bootstrap_run_t));
+    if (run == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    run->group = xEventGroupCreate();
+    run->exit_sem = xSemaphoreCreateCounting (step_num, 0);
+    if (run->group == NULL || run->exit_sem == NULL){
+        if (run->group != NULL){
+            vEventGroupDelete (run->group);
+        }
+        if (run->exit_sem != NULL){
+            vSemaphoreDelete (run->exit_sem);
+        }
+        free (run);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy (run->steps, steps, sizeof(steps[0]) * step_num);
+    run->all_bits = BOOTSTRAP_DEP(step_num) - 1;
+    run->first_error = ESP_OK;
+    run->refs = 1;
+    for (uint8_t i = 0; i < step_num; i++){
+        run->times[i] = (bootstrap_step_time_t) { .result = ESP_ERR_NOT_FINISHED };
+        run->task_args[i] = (bootstrap_task_arg_t) { .run = run, .index = i };
+    }
+    run->start_us = esp_timer_get_time();
+
+    // No core affinity: independent steps are spread over both cores
+    uint8_t created = 0;
+    for (; created < step_num; created++){
+        uint32_t stack_size = steps[created].stack_size ? steps[created].stack_size : CONFIG_BOOTSTRAP_STACK_SIZE;
+        portENTER_CRITICAL (&s_bootstrap_lock);
+        run->refs++;
+        portEXIT_CRITICAL (&s_bootstrap_lock);
+        if (xTaskCreatePinnedToCore (bootstrap_task, steps[created].name, stack_size,
+                                     &run->task_args[created], CONFIG_BOOTSTRAP_TASK_PRIORITY,
+                                     NULL, tskNO_AFFINITY) != pdPASS){
+            ESP_LOGE (TAG, "Failed to create task for step %s", steps[created].name);
+            bootstrap_release (run);
+            bootstrap_fail (run, ESP_ERR_NO_MEM);
+            break;
+        }
+    }
+
+    esp_err_t esp_ret = bootstrap_wait (run, run->all_bits, pdMS_TO_TICKS(CONFIG_BOOTSTRAP_TIMEOUT_MS));
+    if (esp_ret == ESP_ERR_TIMEOUT){
+        // A step is stuck: its task frees the run state when it ends
+        ESP_LOGE (TAG, "Steps not done within %d ms", CONFIG_BOOTSTRAP_TIMEOUT_MS);
+        bootstrap_fail (run, ESP_ERR_TIMEOUT);
+        bootstrap_report (run, step_num, report);
+        bootstrap_release (run);
+        return ESP_ERR_TIMEOUT;
+    }
+    for (uint8_t i = 0; i < created; i++){
+        xSemaphoreTake (run->exit_sem, portMAX_DELAY);
+    }
+    bootstrap_report (run, step_num, report);
+    esp_ret = (esp_ret == ESP_OK) ? ESP_OK : run->first_error;
+    bootstrap_release (run);
+    return esp_ret;
+}
+
+esp_err_t bootstrap_step_nvs(void *arg)
+{
+    // ESP32 WiFi driver uses NVS to store WiFi settings
+    esp_err_t esp_ret = nvs_flash_init();
+    if (esp_ret == ESP_ERR_NVS_NO_FREE_PAGES || esp_ret == ESP_ERR_NVS_NEW_VERSION_FOUND){
+        esp_ret = nvs_flash_erase();
+        if (esp_ret == ESP_OK){
+            esp_ret = nvs_flash_init();
+        }
+    }
+    return esp_ret;
+}
+
+esp_err_t bootstrap_step_netif(void *arg)
+{
+    // Only call once in application, prior to initializing the network driver
+    return esp_netif_init();
+}
+
+esp_err_t bootstrap_step_event_loop(void *arg)
+{
+    // Must be running prior to initializing the network driver
+    esp_err_t esp_ret = esp_event_loop_create_default();
+    return esp_ret == ESP_ERR_INVALID_STATE ? ESP_OK : esp_ret;
+}
+
+esp_err_t bootstrap_step_wifi_sta(void *arg)
+{
+    return wifi_sta_init ((EventGroupHandle_t) arg);
+}
@@ -0,0 +1,115 @@
+#ifndef BOOTSTRAP_H
+#define BOOTSTRAP_H
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/**
+ * @brief Dependency on the step at index i of the step array
+ * A step may only depend on steps placed before it.
+ */
+#define BOOTSTRAP_DEP(i)        (1UL << (i))
+
+/**
+ * @brief Indexes of the steps of BOOTSTRAP_WIFI_STA_STEPS, application steps follow
+ */
+enum {
+    BOOTSTRAP_NVS = 0,
+    BOOTSTRAP_NETIF,
+    BOOTSTRAP_EVENT_LOOP,
+    BOOTSTRAP_WIFI_STA,
+    BOOTSTRAP_USER,             // First free index
+};
+
+/**
+ * @brief Common WiFi station bring-up, to place first in the step array
+ * NVS, network interface and event loop start in parallel, WiFi as soon as all three are done.
+ *
+ * @param event_group Event group handle passed to wifi_sta_init
+ */
+#define BOOTSTRAP_WIFI_STA_STEPS(event_group)                                                       \
+    { .name = "nvs",        .fn = bootstrap_step_nvs },                                             \
+    { .name = "netif",      .fn = bootstrap_step_netif },                                           \
+    { .name = "event_loop", .fn = bootstrap_step_event_loop },                                      \
+    { .name = "wifi_sta",   .fn = bootstrap_step_wifi_sta, .arg = (event_group),                    \
+      .depends = BOOTSTRAP_DEP(BOOTSTRAP_NVS) | BOOTSTRAP_DEP(BOOTSTRAP_NETIF) |                    \
+                 BOOTSTRAP_DEP(BOOTSTRAP_EVENT_LOOP) }
+
+typedef esp_err_t (*bootstrap_fn_t)(void *arg);
+
+/**
+ * @brief One init step
+ */
+typedef struct {
+    const char *name;
+    bootstrap_fn_t fn;
+    void *arg;                  // Passed to fn
+    uint32_t depends;           // BOOTSTRAP_DEP() of the steps that must finish first
+    uint32_t stack_size;        // Task stack (0: CONFIG_BOOTSTRAP_STACK_SIZE)
+} bootstrap_step_t;
+
+/**
+ * @brief Timing of one step, relative to the start of bootstrap_run
+ */
+typedef struct {
+    uint32_t start_us;
+    uint32_t end_us;
+    esp_err_t result;
+} bootstrap_step_time_t;
+
+/**
+ * @brief Startup report
+ */
+typedef struct {
+    uint32_t total_us;          // Wall time of bootstrap_run
+    uint32_t critical_path_us;  // Longest chain of dependent steps
+    uint32_t critical_steps;    // BOOTSTRAP_DEP() of the steps on that chain
+    int64_t ready_us;           // Time since reset when all steps finished
+    uint8_t step_num;
+    bootstrap_step_time_t steps[CONFIG_BOOTSTRAP_MAX_STEPS];
+} bootstrap_report_t;
+
+/**
+ * @brief Run init steps in parallel, each one as soon as its dependencies finish
+ * Every step runs in its own task without core affinity, so independent steps
+ * use both cores. After the first failure no further step is started.
+ * The report is logged and copied to report if not NULL.
+ * The step array is copied, it may live on the caller's stack. On timeout the
+ * stuck steps keep running after the return: their name and arg must stay valid.
+ *
+ * @param[in] steps Step array
+ * @param[in] step_num Number of steps (at most CONFIG_BOOTSTRAP_MAX_STEPS)
+ * @param[out] report Timing report, may be NULL
+ *
+ * @return
+ * - ESP_OK : All steps succeeded
+ * - ESP_ERR_INVALID_ARG : Too many steps or a dependency on a later step
+ * - ESP_ERR_NO_MEM : Failed to create a step task
+ * - ESP_ERR_TIMEOUT : Steps not done within CONFIG_BOOTSTRAP_TIMEOUT_MS
+ * - Other errors : Result of the first failed step
+ */
+esp_err_t bootstrap_run(const bootstrap_step_t *steps, uint8_t step_num, bootstrap_report_t *report);
+
+/**
+ * @brief Initialize NVS, erase and retry if it is full or from a newer version
+ */
+esp_err_t bootstrap_step_nvs(void *arg);
+
+/**
+ * @brief Initialize the TCP/IP network interface
+ */
+esp_err_t bootstrap_step_netif(void *arg);
+
+/**
+ * @brief Create the default event loop
+ */
+esp_err_t bootstrap_step_event_loop(void *arg);
+
+/**
+ * @brief Initialize WiFi in station mode
+ *
+ * @param arg EventGroupHandle_t passed to wifi_sta_init
+ */
+esp_err_t bootstrap_step_wifi_sta(void *arg);
+
+#endif // BOOTSTRAP_H
@@ -0,0 +1,110 @@
+#ifndef WIFI_CONN_H
+#define WIFI_CONN_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief Pooled TLS connection handle
+ */
+typedef struct wifi_conn *wifi_conn_handle_t;
+
+/**
+ * @brief Server to connect to
+ */
+typedef struct {
+    const char *host;           // Host name, also used for SNI and certificate check
+    uint16_t port;
+    const char *ca_pem;         // Server CA certificate (NULL: ESP-IDF certificate bundle)
+} wifi_conn_target_t;
+
+/**
+ * @brief Connection manager statistics
+ */
+typedef struct {
+    uint32_t reused;            // Acquire served by a live pooled connection
+    uint32_t handshakes;        // New TLS handshakes
+    uint32_t handshakes_cached; // New handshakes offered a cached session
+    uint32_t handshake_avg_ms;  // Average handshake time
+    uint32_t dropped;           // Connections closed on disconnect or error
+} wifi_conn_stats_t;
+
+/**
+ * @brief Initialize the connection manager
+ * Restores the TLS session kept in RTC memory across deep sleep and closes
+ * pooled connections on WIFI_EVENT_STA_DISCONNECTED.
+ * !! You must call wifi_sta_init() before call this function.
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_STATE : WiFi not initialized
+ * - ESP_ERR_NO_MEM : Out of memory
+ */
+esp_err_t wifi_conn_init(void);
+
+/**
+ * @brief Get a TLS connection to the target
+ * Reuses an idle live connection to the same host and port, otherwise opens a
+ * new one and offers the cached TLS session for an abbreviated handshake.
+ * Waits up to CONFIG_WIFI_CONN_TIMEOUT_MS for WIFI_STA_IPV4_OBTAINED_BIT.
+ *
+ * @param[in] target Server to connect to
+ * @param[out] conn Connection handle, give it back with wifi_conn_release
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_ARG : Invalid target
+ * - ESP_ERR_NOT_FOUND : All pool slots are busy
+ * - ESP_ERR_TIMEOUT : No IPv4 address
+ * - ESP_FAIL : Connection or handshake failed
+ */
+esp_err_t wifi_conn_acquire(const wifi_conn_target_t *target, wifi_conn_handle_t *conn);
+
+/**
+ * @brief Write all data
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_FAIL : Connection broken, release it
+ */
+esp_err_t wifi_conn_write(wifi_conn_handle_t conn, const void *data, size_t len);
+
+/**
+ * @brief Read available data
+ *
+ * @param[out] received Bytes read
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_TIMEOUT : Nothing received within CONFIG_WIFI_CONN_TIMEOUT_MS
+ * - ESP_FAIL : Connection closed or broken, release it
+ */
+esp_err_t wifi_conn_read(wifi_conn_handle_t conn, void *buf, size_t len, size_t *received);
+
+/**
+ * @brief Give a connection back to the pool
+ * A TLS 1.3 ticket received on the connection replaces the cached session
+ * (and the copy in RTC memory) for later handshakes.
+ *
+ * @param conn Connection handle
+ * @param keep_alive true to keep the connection open for reuse, false to close it
+ */
+void wifi_conn_release(wifi_conn_handle_t conn, bool keep_alive);
+
+/**
+ * @brief Close all idle connections, busy ones are closed on release
+ * Cached TLS sessions are kept.
+ */
+void wifi_conn_close_all(void);
+
+/**
+ * @brief Copy the statistics
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_ARG : stats is NULL
+ */
+esp_err_t wifi_conn_get_stats(wifi_conn_stats_t *stats);
+
+#endif // WIFI_CONN_H
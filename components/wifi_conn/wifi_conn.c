@@ -0,0 +1,650 @@
+#include "wifi_conn.h"
+#include "wifi_sta.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_crt_bundle.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/x509_crt.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+// Tag for debug messages
+static const char* TAG = "WIFI_CONN";
+
+#define CONN_RTC_MAGIC  0x4E4E4357  // "WCNN"
+
+/**
+ * @brief Pool slot
+ */
+struct wifi_conn {
+    bool open;              // TLS connection established
+    bool busy;              // Acquired by a caller
+    bool broken;            // Link lost or I/O error while busy
+    bool new_ticket;        // TLS 1.3 ticket received since the session was cached
+    char host[CONFIG_WIFI_CONN_HOST_MAX_LEN];
+    uint16_t port;
+    int64_t last_used_us;
+    mbedtls_net_context net;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_x509_crt ca;
+};
+
+/**
+ * @brief Cached TLS session of one server
+ */
+typedef struct {
+    bool valid;
+    char host[CONFIG_WIFI_CONN_HOST_MAX_LEN];
+    uint16_t port;
+    int64_t saved_us;
+    mbedtls_ssl_session session;
+} conn_session_t;
+
+#if CONFIG_WIFI_CONN_RTC_SESSION
+/**
+ * @brief Last session serialized in RTC memory, kept across deep sleep
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t port;
+    uint16_t len;
+    char host[CONFIG_WIFI_CONN_HOST_MAX_LEN];
+    uint8_t data[CONFIG_WIFI_CONN_RTC_SESSION_SIZE];
+} conn_rtc_session_t;
+
+static RTC_DATA_ATTR conn_rtc_session_t s_rtc_session;
+#endif
+
+// Static global variables
+static struct wifi_conn s_pool[CONFIG_WIFI_CONN_POOL_SIZE];
+static conn_session_t s_sessions[CONFIG_WIFI_CONN_SESSION_CACHE];
+static SemaphoreHandle_t s_conn_lock = NULL;
+static wifi_conn_stats_t s_stats;
+static uint64_t s_handshake_total_ms = 0;
+
+/******************************
+ * Private functions prototypes
+ */
+
+static void on_wifi_disconnected (void* arg,
+                                  esp_event_base_t event_base,
+                                  int32_t event_id,
+                                  void* event_data);
+
+static int conn_rng (void *ctx, unsigned char *buf, size_t len);
+
+static conn_session_t *conn_session_find (const char *host, uint16_t port);
+
+static void conn_session_store (struct wifi_conn *conn);
+
+static void conn_rtc_save (const conn_session_t *cached);
+
+static void conn_rtc_restore (void);
+
+static esp_err_t conn_setup (struct wifi_conn *conn, const wifi_conn_target_t *target);
+
+static bool conn_idle_usable (struct wifi_conn *conn);
+
+static esp_err_t conn_tcp_connect (struct wifi_conn *conn, const char *port_str);
+
+static esp_err_t conn_handshake (struct wifi_conn *conn);
+
+static void conn_close (struct wifi_conn *conn);
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+/**
+ * @brief Close idle connections when the station loses the AP
+ * Connections in use are marked broken and closed on release.
+ */
+static void on_wifi_disconnected (void* arg,
+                                  esp_event_base_t event_base,
+                                  int32_t event_id,
+                                  void* event_data)
+{
+    xSemaphoreTake (s_conn_lock, portMAX_DELAY);
+    for (int i = 0; i < CONFIG_WIFI_CONN_POOL_SIZE; i++){
+        struct wifi_conn *conn = &s_pool[i];
+        if (!conn->open){
+            continue;
+        }
+        conn->broken = true;
+        if (!conn->busy){
+            conn_close (conn);
+        }
+    }
+    xSemaphoreGive (s_conn_lock);
+}
+
+/**
+ * @brief mbedtls RNG backed by the hardware RNG
+ */
+static int conn_rng (void *ctx, unsigned char *buf, size_t len)
+{
+    esp_fill_random (buf, len);
+    return 0;
+}
+
+static conn_session_t *conn_session_find (const char *host, uint16_t port)
+{
+    for (int i = 0; i < CONFIG_WIFI_CONN_SESSION_CACHE; i++){
+        if (s_sessions[i].valid && s_sessions[i].port == port && strcmp (s_sessions[i].host, host) == 0){
+            return &s_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Cache the session of a connection (call with s_conn_lock held)
+ * Replaces the entry of the same server, else the oldest entry.
+ * mbedtls 3 exports a session once per handshake or ticket: the export goes to a
+ * new session first so a refused export keeps the cached entry.
+ */
+static void conn_session_store (struct wifi_conn *conn)
+{
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init (&session);
+    if (mbedtls_ssl_get_session (&conn->ssl, &session) != 0){
+        mbedtls_ssl_session_free (&session);
+        return;
+    }
+    conn->new_ticket = false;
+
+    conn_session_t *cached = conn_session_find (conn->host, conn->port);
+    if (cached == NULL){
+        cached = &s_sessions[0];
+        for (int i = 0; i < CONFIG_WIFI_CONN_SESSION_CACHE; i++){
+            if (!s_sessions[i].valid){
+                cached = &s_sessions[i];
+                break;
+            }
+            if (s_sessions[i].saved_us < cached->saved_us){
+                cached = &s_sessions[i];
+            }
+        }
+    }
+    if (cached->valid){
+        mbedtls_ssl_session_free (&cached->session);
+    }
+    // The cache owns the exported session from here
+    cached->session = session;
+    cached->valid = true;
+    strlcpy (cached->host, conn->host, sizeof(cached->host));
+    cached->port = conn->port;
+    cached->saved_us = esp_timer_get_time();
+    conn_rtc_save (cached);
+}
+
+static void conn_rtc_save (const conn_session_t *cached)
+{
+#if CONFIG_WIFI_CONN_RTC_SESSION
+    size_t len = 0;
+    s_rtc_session.magic = 0;
+    if (mbedtls_ssl_session_save (&cached->session, s_rtc_session.data, sizeof(s_rtc_session.data), &len) != 0){
+        ESP_LOGD (TAG, "Session does not fit in RTC memory");
+        return;
+    }
+    strlcpy (s_rtc_session.host, cached->host, sizeof(s_rtc_session.host));
+    s_rtc_session.port = cached->port;
+    s_rtc_session.len = (uint16_t) len;
+    s_rtc_session.magic = CONN_RTC_MAGIC;
+#endif
+}
+
+static void conn_rtc_restore (void)
+{
+#if CONFIG_WIFI_CONN_RTC_SESSION
+    if (s_rtc_session.magic != CONN_RTC_MAGIC || s_rtc_session.len > sizeof(s_rtc_session.data)){
+        return;
+    }
+    conn_session_t *cached = &s_sessions[0];
+    mbedtls_ssl_session_init (&cached->session);
+    if (mbedtls_ssl_session_load (&cached->session, s_rtc_session.data, s_rtc_session.len) != 0){
+        mbedtls_ssl_session_free (&cached->session);
+        s_rtc_session.magic = 0;
+        return;
+    }
+    strlcpy (cached->host, s_rtc_session.host, sizeof(cached->host));
+    cached->port = s_rtc_session.port;
+    cached->saved_us = esp_timer_get_time();
+    cached->valid = true;
+    ESP_LOGI (TAG, "Restored TLS session for %s:%d", cached->host, cached->port);
+#endif
+}
+
+/**
+ * @brief Prepare the TLS context and offer the cached session (call with s_conn_lock held)
+ */
+static esp_err_t conn_setup (struct wifi_conn *conn, const wifi_conn_target_t *target)
+{
+    mbedtls_net_init (&conn->net);
+    mbedtls_ssl_init (&conn->ssl);
+    mbedtls_ssl_config_init (&conn->conf);
+    mbedtls_x509_crt_init (&conn->ca);
+    strlcpy (conn->host, target->host, sizeof(conn->host));
+    conn->port = target->port;
+    conn->broken = false;
+    conn->new_ticket = false;
+
+    if (mbedtls_ssl_config_defaults (&conn->conf, MBEDTLS_SSL_IS_CLIENT,
+                                     MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT) != 0){
+        return ESP_FAIL;
+    }
+    if (target->ca_pem != NULL){
+        if (mbedtls_x509_crt_parse (&conn->ca, (const unsigned char*) target->ca_pem, strlen (target->ca_pem) + 1) != 0){
+            ESP_LOGE (TAG, "Failed to parse CA certificate");
+            return ESP_ERR_INVALID_ARG;
+        }
+        mbedtls_ssl_conf_ca_chain (&conn->conf, &conn->ca, NULL);
+    }
+    else if (esp_crt_bundle_attach (&conn->conf) != ESP_OK){
+        ESP_LOGE (TAG, "Failed to attach certificate bundle");
+        return ESP_FAIL;
+    }
+    mbedtls_ssl_conf_authmode (&conn->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_rng (&conn->conf, conn_rng, NULL);
+    mbedtls_ssl_conf_read_timeout (&conn->conf, CONFIG_WIFI_CONN_TIMEOUT_MS);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets (&conn->conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_SESSION_TICKETS) && \
+    defined(MBEDTLS_SSL_TLS1_3_SIGNAL_NEW_SESSION_TICKETS_ENABLED)
+    // mbedtls >= 3.6.1 drops TLS 1.3 tickets unless the client asks to be told about them
+    mbedtls_ssl_conf_tls13_enable_signal_new_session_tickets (&conn->conf,
+                                                              MBEDTLS_SSL_TLS1_3_SIGNAL_NEW_SESSION_TICKETS_ENABLED);
+#endif
+    if (mbedtls_ssl_setup (&conn->ssl, &conn->conf) != 0 ||
+        mbedtls_ssl_set_hostname (&conn->ssl, conn->host) != 0){
+        return ESP_FAIL;
+    }
+
+    // Abbreviated handshake if the server still knows this session
+    conn_session_t *cached = conn_session_find (conn->host, conn->port);
+    if (cached != NULL && mbedtls_ssl_set_session (&conn->ssl, &cached->session) == 0){
+        s_stats.handshakes_cached++;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Process what arrived on an idle pooled connection (call with s_conn_lock held)
+ * TLS 1.3 servers send tickets after the handshake: they are read and cached.
+ * End of stream, close notify, socket errors or unexpected application data
+ * make the connection unusable.
+ */
+static bool conn_idle_usable (struct wifi_conn *conn)
+{
+    unsigned char byte;
+    while (1){
+        int ret = recv (conn->net.fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+            break;
+        }
+        if (ret <= 0){
+            return false;
+        }
+        ret = mbedtls_ssl_read (&conn->ssl, &byte, sizeof(byte));
+#if defined(MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET)
+        if (ret == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET){
+            conn->new_ticket = true;
+            continue;
+        }
+#endif
+        return false;
+    }
+    if (conn->new_ticket){
+        conn_session_store (conn);
+    }
+    return true;
+}
+
+/**
+ * @brief Non-blocking TCP connect, each address gets CONFIG_WIFI_CONN_TIMEOUT_MS
+ * mbedtls_net_connect blocks until the TCP stack gives up (minutes for a silent host).
+ */
+static esp_err_t conn_tcp_connect (struct wifi_conn *conn, const char *port_str)
+{
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+        .ai_protocol = IPPROTO_TCP,
+    };
+    struct addrinfo *addr_list = NULL;
+    if (getaddrinfo (conn->host, port_str, &hints, &addr_list) != 0 || addr_list == NULL){
+        ESP_LOGE (TAG, "Failed to resolve %s", conn->host);
+        return ESP_FAIL;
+    }
+    esp_err_t esp_ret = ESP_FAIL;
+    for (struct addrinfo *addr = addr_list; addr != NULL && esp_ret != ESP_OK; addr = addr->ai_next){
+        int fd = socket (addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (fd < 0){
+            continue;
+        }
+        int flags = fcntl (fd, F_GETFL, 0);
+        fcntl (fd, F_SETFL, flags | O_NONBLOCK);
+        int ret = connect (fd, addr->ai_addr, addr->ai_addrlen);
+        if (ret != 0 && errno == EINPROGRESS){
+            fd_set write_set;
+            FD_ZERO (&write_set);
+            FD_SET (fd, &write_set);
+            struct timeval timeout = {
+                .tv_sec = CONFIG_WIFI_CONN_TIMEOUT_MS / 1000,
+                .tv_usec = (CONFIG_WIFI_CONN_TIMEOUT_MS % 1000) * 1000,
+            };
+            int error = ETIMEDOUT;
+            socklen_t error_len = sizeof(error);
+            if (select (fd + 1, NULL, &write_set, NULL, &timeout) == 1){
+                getsockopt (fd, SOL_SOCKET, SO_ERROR, &error, &error_len);
+            }
+            ret = (error == 0) ? 0 : -1;
+        }
+        if (ret != 0){
+            close (fd);
+            continue;
+        }
+        // Blocking again: mbedtls_net_recv_timeout waits with select
+        fcntl (fd, F_SETFL, flags);
+        conn->net.fd = fd;
+        esp_ret = ESP_OK;
+    }
+    freeaddrinfo (addr_list);
+    return esp_ret;
+}
+
+/**
+ * @brief TCP connect with keep-alive, then TLS handshake (without s_conn_lock)
+ */
+static esp_err_t conn_handshake (struct wifi_conn *conn)
+{
+    char port_str[6];
+    snprintf (port_str, sizeof(port_str), "%u", conn->port);
+    int64_t start_us = esp_timer_get_time();
+    if (conn_tcp_connect (conn, port_str) != ESP_OK){
+        ESP_LOGE (TAG, "Failed to connect to %s:%s", conn->host, port_str);
+        return ESP_FAIL;
+    }
+
+    // Detect dead peers while the connection sits idle in the pool
+    int keep_alive = 1;
+    int keep_idle = CONFIG_WIFI_CONN_KEEPALIVE_IDLE_S;
+    int keep_interval = CONFIG_WIFI_CONN_KEEPALIVE_INTERVAL_S;
+    int keep_count = CONFIG_WIFI_CONN_KEEPALIVE_COUNT;
+    setsockopt (conn->net.fd, SOL_SOCKET, SO_KEEPALIVE, &keep_alive, sizeof(keep_alive));
+    setsockopt (conn->net.fd, IPPROTO_TCP, TCP_KEEPIDLE, &keep_idle, sizeof(keep_idle));
+    setsockopt (conn->net.fd, IPPROTO_TCP, TCP_KEEPINTVL, &keep_interval, sizeof(keep_interval));
+    setsockopt (conn->net.fd, IPPROTO_TCP, TCP_KEEPCNT, &keep_count, sizeof(keep_count));
+
+    mbedtls_ssl_set_bio (&conn->ssl, &conn->net, mbedtls_net_send, mbedtls_net_recv, mbedtls_net_recv_timeout);
+    int ret;
+    while ((ret = mbedtls_ssl_handshake (&conn->ssl)) != 0){
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE){
+            ESP_LOGE (TAG, "TLS handshake with %s failed (-0x%x)", conn->host, -ret);
+            return ESP_FAIL;
+        }
+    }
+    conn->open = true;
+    uint32_t elapsed_ms = (uint32_t) ((esp_timer_get_time() - start_us) / 1000);
+    ESP_LOGD (TAG, "Connected to %s:%s in %" PRIu32 " ms", conn->host, port_str, elapsed_ms);
+
+    xSemaphoreTake (s_conn_lock, portMAX_DELAY);
+    s_stats.handshakes++;
+    s_handshake_total_ms += elapsed_ms;
+    s_stats.handshake_avg_ms = (uint32_t) (s_handshake_total_ms / s_stats.handshakes);
+    conn_session_store (conn);
+    xSemaphoreGive (s_conn_lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief Free the TLS context, notify the peer if the link is up
+ */
+static void conn_close (struct wifi_conn *conn)
+{
+    if (conn->open && !conn->broken){
+        mbedtls_ssl_close_notify (&conn->ssl);
+    }
+    if (conn->broken){
+        s_stats.dropped++;
+    }
+    mbedtls_net_free (&conn->net);
+    mbedtls_ssl_free (&conn->ssl);
+    mbedtls_ssl_config_free (&conn->conf);
+    mbedtls_x509_crt_free (&conn->ca);
+    conn->open = false;
+    conn->broken = false;
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+esp_err_t wifi_conn_init(void)
+{
+    if (e_wifi_event_group == NULL){
+        ESP_LOGE (TAG, "WiFi is not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_conn_lock != NULL){
+        return ESP_OK;
+    }
+    s_conn_lock = xSemaphoreCreateMutex();
+    if (s_conn_lock == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t esp_ret = esp_event_handler_register (WIFI_EVENT,
+                                                    WIFI_EVENT_STA_DISCONNECTED,
+                                                    &on_wifi_disconnected,
+                                                    NULL);
+    if (esp_ret != ESP_OK){
+        ESP_LOGE (TAG, "Failed to register WiFi event handler");
+        return esp_ret;
+    }
+    conn_rtc_restore ();
+    return ESP_OK;
+}
+
+esp_err_t wifi_conn_acquire(const wifi_conn_target_t *target, wifi_conn_handle_t *conn)
+{
+    if (target == NULL || target->host == NULL || conn == NULL ||
+        strlen (target->host) >= CONFIG_WIFI_CONN_HOST_MAX_LEN){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_conn_lock == NULL){
+        ESP_LOGE (TAG, "Connection manager is not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    EventBits_t uxBit = xEventGroupWaitBits (e_wifi_event_group,
+                                             WIFI_STA_IPV4_OBTAINED_BIT,
+                                             pdFALSE,
+                                             pdTRUE,
+                                             pdMS_TO_TICKS(CONFIG_WIFI_CONN_TIMEOUT_MS));
+    if (!(uxBit & WIFI_STA_IPV4_OBTAINED_BIT)){
+        return ESP_ERR_TIMEOUT;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    struct wifi_conn *slot = NULL;
+    xSemaphoreTake (s_conn_lock, portMAX_DELAY);
+    for (int i = 0; i < CONFIG_WIFI_CONN_POOL_SIZE; i++){
+        struct wifi_conn *pooled = &s_pool[i];
+        if (!pooled->open || pooled->busy){
+            continue;
+        }
+        // Drop connections idle for too long or closed by the peer
+        if (now_us - pooled->last_used_us > (int64_t) CONFIG_WIFI_CONN_IDLE_TIMEOUT_MS * 1000 ||
+            !conn_idle_usable (pooled)){
+            conn_close (pooled);
+            continue;
+        }
+        if (pooled->port == target->port && strcmp (pooled->host, target->host) == 0){
+            pooled->busy = true;
+            pooled->last_used_us = now_us;
+            s_stats.reused++;
+            xSemaphoreGive (s_conn_lock);
+            *conn = pooled;
+            return ESP_OK;
+        }
+    }
+
+    // New connection: free slot first, else the least recently used idle one
+    for (int i = 0; i < CONFIG_WIFI_CONN_POOL_SIZE; i++){
+        struct wifi_conn *pooled = &s_pool[i];
+        if (pooled->busy){
+            continue;
+        }
+        if (!pooled->open){
+            slot = pooled;
+            break;
+        }
+        if (slot == NULL || pooled->last_used_us < slot->last_used_us){
+            slot = pooled;
+        }
+    }
+    if (slot == NULL){
+        xSemaphoreGive (s_conn_lock);
+        ESP_LOGE (TAG, "All connections are busy");
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (slot->open){
+        conn_close (slot);
+    }
+    slot->busy = true;
+    esp_err_t esp_ret = conn_setup (slot, target);
+    xSemaphoreGive (s_conn_lock);
+
+    if (esp_ret == ESP_OK){
+        esp_ret = conn_handshake (slot);
+    }
+    if (esp_ret != ESP_OK){
+        xSemaphoreTake (s_conn_lock, portMAX_DELAY);
+        conn_close (slot);
+        slot->busy = false;
+        xSemaphoreGive (s_conn_lock);
+        return esp_ret;
+    }
+    slot->last_used_us = esp_timer_get_time();
+    *conn = slot;
+    return ESP_OK;
+}
+
+esp_err_t wifi_conn_write(wifi_conn_handle_t conn, const void *data, size_t len)
+{
+    if (conn == NULL || !conn->open || conn->broken){
+        return ESP_FAIL;
+    }
+    const unsigned char *bytes = (const unsigned char*) data;
+    size_t written = 0;
+    while (written < len){
+        int ret = mbedtls_ssl_write (&conn->ssl, bytes + written, len - written);
+        if (ret > 0){
+            written += ret;
+        }
+        else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE){
+            ESP_LOGE (TAG, "Write to %s failed (-0x%x)", conn->host, -ret);
+            conn->broken = true;
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t wifi_conn_read(wifi_conn_handle_t conn, void *buf, size_t len, size_t *received)
+{
+    if (received != NULL){
+        *received = 0;
+    }
+    if (conn == NULL || received == NULL || !conn->open || conn->broken){
+        return ESP_FAIL;
+    }
+    while (1){
+        int ret = mbedtls_ssl_read (&conn->ssl, (unsigned char*) buf, len);
+        if (ret > 0){
+            *received = ret;
+            return ESP_OK;
+        }
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE){
+            continue;
+        }
+#if defined(MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET)
+        if (ret == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET){
+            // TLS 1.3 ticket, cached when the connection is released
+            conn->new_ticket = true;
+            continue;
+        }
+#endif
+        if (ret == MBEDTLS_ERR_SSL_TIMEOUT){
+            return ESP_ERR_TIMEOUT;
+        }
+        // 0 or close notify: peer closed the connection
+        conn->broken = (ret != 0 && ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY);
+        if (!conn->broken){
+            conn->open = false;
+            mbedtls_net_free (&conn->net);
+        }
+        return ESP_FAIL;
+    }
+}
+
+void wifi_conn_release(wifi_conn_handle_t conn, bool keep_alive)
+{
+    if (conn == NULL){
+        return;
+    }
+    xSemaphoreTake (s_conn_lock, portMAX_DELAY);
+    if (conn->open && !conn->broken && conn->new_ticket){
+        // Refresh the cache: TLS 1.3 tickets arrive after the handshake
+        conn_session_store (conn);
+    }
+    if (!keep_alive || !conn->open || conn->broken){
+        conn_close (conn);
+    }
+    conn->busy = false;
+    conn->last_used_us = esp_timer_get_time();
+    xSemaphoreGive (s_conn_lock);
+}
+
+void wifi_conn_close_all(void)
+{
+    if (s_conn_lock == NULL){
+        return;
+    }
+    xSemaphoreTake (s_conn_lock, portMAX_DELAY);
+    for (int i = 0; i < CONFIG_WIFI_CONN_POOL_SIZE; i++){
+        if (s_pool[i].open && !s_pool[i].busy){
+            conn_close (&s_pool[i]);
+        }
+    }
+    xSemaphoreGive (s_conn_lock);
+}
+
+esp_err_t wifi_conn_get_stats(wifi_conn_stats_t *stats)
+{
+    if (stats == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_conn_lock != NULL){
+        xSemaphoreTake (s_conn_lock, portMAX_DELAY);
+    }
+    *stats = s_stats;
+    if (s_conn_lock != NULL){
+        xSemaphoreGive (s_conn_lock);
+    }
+    return ESP_OK;
+}
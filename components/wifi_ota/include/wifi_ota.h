@@ -0,0 +1,107 @@
+#ifndef WIFI_OTA_H
+#define WIFI_OTA_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief Where the image comes from (default: esp_http_client, see wifi_ota_source_http)
+ * Called from the task running wifi_ota_run(), one request at a time.
+ */
+typedef struct {
+    // Send a request for the image from byte offset, get the HTTP status and the body length (-1: unknown)
+    esp_err_t (*open)(void *ctx, size_t offset, int *status, int64_t *content_length);
+    // Bytes read, 0 at the end of the body, < 0 if the connection is lost
+    int (*read)(void *ctx, uint8_t *buf, size_t len);
+    // Whole body received
+    bool (*is_complete)(void *ctx);
+    void (*close)(void *ctx);
+    void *ctx;
+} wifi_ota_source_t;
+
+/**
+ * @brief Where the image goes (default: next OTA partition, see wifi_ota_sink_flash)
+ * write is called from the writer task, in image order.
+ */
+typedef struct {
+    esp_err_t (*begin)(void *ctx);
+    esp_err_t (*write)(void *ctx, const uint8_t *data, size_t len);
+    // Validate the image and select it for the next boot
+    esp_err_t (*end)(void *ctx);
+    void (*abort)(void *ctx);
+    void *ctx;
+} wifi_ota_sink_t;
+
+/**
+ * @brief OTA update configuration
+ */
+typedef struct {
+    const char *url;                    // Firmware image URL (http or https)
+    const char *cert_pem;               // Server CA certificate (NULL: ESP-IDF certificate bundle)
+    const uint8_t *sha256;              // Expected SHA-256 of the image, 32 bytes (NULL: no hash check)
+    const wifi_ota_source_t *source;    // NULL: HTTP client on url
+    const wifi_ota_sink_t *sink;        // NULL: next OTA partition
+} wifi_ota_config_t;
+
+/**
+ * @brief Download progress
+ */
+typedef struct {
+    size_t received;            // Bytes received
+    size_t written;             // Bytes written to flash
+    int total;                  // Image size, -1 while unknown
+    uint8_t resumes;            // Download resumed after a lost connection
+} wifi_ota_progress_t;
+
+/**
+ * @brief Download and flash a new firmware image to the next OTA partition
+ * The calling task receives into one buffer while a writer task erases and
+ * writes the other one, so network reads and flash writes overlap.
+ * The SHA-256 of the image is computed while writing.
+ * If the connection is lost, waits for the wifi_sta reconnect path to set
+ * WIFI_STA_IPV4_OBTAINED_BIT again and resumes with an HTTP Range request.
+ * WIFI_CHOSEN_STA_RECONENCT is set while the update runs so the station
+ * reconnects, and restored afterwards.
+ * Blocks until the update is done, the boot partition is set on success.
+ * !! You must call wifi_sta_init() before call this function.
+ *
+ * @param[in] config OTA configuration
+ *
+ * @return
+ * - ESP_OK : New image written and selected for next boot
+ * - ESP_ERR_INVALID_ARG : Invalid configuration
+ * - ESP_ERR_INVALID_STATE : Update already running
+ * - ESP_ERR_INVALID_CRC : SHA-256 does not match
+ * - ESP_ERR_TIMEOUT : Connection not restored in time
+ * - Other errors from the source (esp_http_client) or the sink (esp_ota_ops)
+ */
+esp_err_t wifi_ota_run(const wifi_ota_config_t *config);
+
+/**
+ * @brief Get the progress of the running (or last) update
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_ARG : progress is NULL
+ */
+esp_err_t wifi_ota_get_progress(wifi_ota_progress_t *progress);
+
+/**
+ * @brief Image source over esp_http_client (used when config->source is NULL)
+ * Follows up to 5 redirects (301, 302, 303, 307, 308) per request, resumed
+ * requests start again from url.
+ * Only one instance: valid until the next call.
+ *
+ * @param[in] url Firmware image URL (http or https)
+ * @param[in] cert_pem Server CA certificate (NULL: ESP-IDF certificate bundle)
+ */
+const wifi_ota_source_t *wifi_ota_source_http(const char *url, const char *cert_pem);
+
+/**
+ * @brief Image sink writing the next OTA partition (used when config->sink is NULL)
+ * esp_ota_write erases each sector right before writing it (sequential writes).
+ */
+const wifi_ota_sink_t *wifi_ota_sink_flash(void);
+
+#endif // WIFI_OTA_H
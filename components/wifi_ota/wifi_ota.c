@@ -0,0 +1,332 @@
+#include "wifi_ota.h"
+#include "wifi_sta.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "mbedtls/sha256.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/event_groups.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Tag for debug messages
+static const char* TAG = "WIFI_OTA";
+
+#define OTA_BUFFER_NUM  2
+
+/**
+ * @brief One half of the double buffer
+ */
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} ota_buffer_t;
+
+// Static global variables
+static ota_buffer_t s_buffers[OTA_BUFFER_NUM];
+static QueueHandle_t s_free_queue = NULL;   // Buffers ready to receive
+static QueueHandle_t s_full_queue = NULL;   // Buffers ready to write, NULL stops the writer
+static TaskHandle_t s_receiver_task = NULL;
+static const wifi_ota_sink_t *s_sink = NULL;
+static mbedtls_sha256_context s_sha;
+static volatile esp_err_t s_write_err = ESP_OK;
+static volatile bool s_running = false;
+static wifi_ota_progress_t s_progress = { .total = -1 };
+static portMUX_TYPE s_progress_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************
+ * Private functions prototypes
+ */
+
+static void ota_writer_task (void *arg);
+
+static esp_err_t ota_download (const wifi_ota_source_t *source, ota_buffer_t **current);
+
+static esp_err_t ota_pipeline_create (void);
+
+static void ota_pipeline_delete (void);
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+/**
+ * @brief Hash and write full buffers while the receiver fills the other one
+ */
+static void ota_writer_task (void *arg)
+{
+    ota_buffer_t *buffer;
+    while (xQueueReceive (s_full_queue, &buffer, portMAX_DELAY) == pdTRUE && buffer != NULL){
+        if (s_write_err == ESP_OK){
+            mbedtls_sha256_update (&s_sha, buffer->data, buffer->len);
+            esp_err_t esp_ret = s_sink->write (s_sink->ctx, buffer->data, buffer->len);
+            if (esp_ret != ESP_OK){
+                ESP_LOGE (TAG, "ERROR (%d): Failed to write image to flash", esp_ret);
+                s_write_err = esp_ret;
+            }
+            else {
+                portENTER_CRITICAL (&s_progress_lock);
+                s_progress.written += buffer->len;
+                portEXIT_CRITICAL (&s_progress_lock);
+            }
+        }
+        buffer->len = 0;
+        xQueueSend (s_free_queue, &buffer, portMAX_DELAY);
+    }
+    xTaskNotifyGive (s_receiver_task);
+    vTaskDelete (NULL);
+}
+
+/**
+ * @brief One HTTP session, starting at the bytes already received
+ *
+ * @return
+ * - ESP_OK : Whole image received
+ * - ESP_ERR_NOT_FINISHED : Connection lost, can be resumed
+ * - Other errors : Not recoverable
+ */
+static esp_err_t ota_download (const wifi_ota_source_t *source, ota_buffer_t **current)
+{
+    // Ask only for the missing part of the image
+    size_t offset = s_progress.received;
+    int status = 0;
+    int64_t content_length = -1;
+    esp_err_t esp_ret = source->open (source->ctx, offset, &status, &content_length);
+    if (esp_ret == ESP_ERR_NO_MEM){
+        return esp_ret;
+    }
+    if (esp_ret != ESP_OK){
+        source->close (source->ctx);
+        return ESP_ERR_NOT_FINISHED;
+    }
+    size_t skip = 0;
+    if (status == 206 || (status == 200 && offset == 0)){
+        if (s_progress.total < 0 && content_length >= 0){
+            s_progress.total = (int) (offset + content_length);
+        }
+    }
+    else if (status == 200){
+        // Server ignored the Range header: drop what we already have
+        skip = offset;
+        if (s_progress.total < 0 && content_length >= 0){
+            s_progress.total = (int) content_length;
+        }
+    }
+    else {
+        ESP_LOGE (TAG, "HTTP status %d", status);
+        source->close (source->ctx);
+        return ESP_FAIL;
+    }
+
+    while (1){
+        if (s_write_err != ESP_OK){
+            esp_ret = s_write_err;
+            break;
+        }
+        if (*current == NULL){
+            xQueueReceive (s_free_queue, current, portMAX_DELAY);
+        }
+        ota_buffer_t *buffer = *current;
+        int len = source->read (source->ctx, buffer->data + buffer->len, CONFIG_WIFI_OTA_BUFFER_SIZE - buffer->len);
+        if (len < 0){
+            esp_ret = ESP_ERR_NOT_FINISHED;
+            break;
+        }
+        if (len == 0){
+            bool complete = source->is_complete (source->ctx) ||
+                            (s_progress.total >= 0 && s_progress.received >= (size_t) s_progress.total);
+            esp_ret = complete ? ESP_OK : ESP_ERR_NOT_FINISHED;
+            break;
+        }
+        if (skip > 0){
+            if ((size_t) len <= skip){
+                skip -= len;
+                continue;
+            }
+            memmove (buffer->data + buffer->len, buffer->data + buffer->len + skip, len - skip);
+            len -= skip;
+            skip = 0;
+        }
+        buffer->len += len;
+        portENTER_CRITICAL (&s_progress_lock);
+        s_progress.received += len;
+        portEXIT_CRITICAL (&s_progress_lock);
+        if (buffer->len == CONFIG_WIFI_OTA_BUFFER_SIZE){
+            // Hand the full buffer to the writer and receive into the other one
+            xQueueSend (s_full_queue, &buffer, portMAX_DELAY);
+            *current = NULL;
+        }
+    }
+    source->close (source->ctx);
+    return esp_ret;
+}
+
+static esp_err_t ota_pipeline_create (void)
+{
+    s_free_queue = xQueueCreate (OTA_BUFFER_NUM, sizeof(ota_buffer_t*));
+    s_full_queue = xQueueCreate (OTA_BUFFER_NUM + 1, sizeof(ota_buffer_t*));
+    if (s_free_queue == NULL || s_full_queue == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < OTA_BUFFER_NUM; i++){
+        s_buffers[i].data = (uint8_t*) malloc (CONFIG_WIFI_OTA_BUFFER_SIZE);
+        s_buffers[i].len = 0;
+        if (s_buffers[i].data == NULL){
+            return ESP_ERR_NO_MEM;
+        }
+        ota_buffer_t *buffer = &s_buffers[i];
+        xQueueSend (s_free_queue, &buffer, 0);
+    }
+    return ESP_OK;
+}
+
+static void ota_pipeline_delete (void)
+{
+    for (int i = 0; i < OTA_BUFFER_NUM; i++){
+        free (s_buffers[i].data);
+        s_buffers[i].data = NULL;
+    }
+    if (s_free_queue != NULL){
+        vQueueDelete (s_free_queue);
+        s_free_queue = NULL;
+    }
+    if (s_full_queue != NULL){
+        vQueueDelete (s_full_queue);
+        s_full_queue = NULL;
+    }
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+esp_err_t wifi_ota_run(const wifi_ota_config_t *config)
+{
+    if (config == NULL || config->url == NULL){
+        ESP_LOGE (TAG, "Invalid OTA configuration");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_running || e_wifi_event_group == NULL){
+        ESP_LOGE (TAG, "OTA already running or WiFi not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    const wifi_ota_source_t *source = config->source ? config->source
+                                                     : wifi_ota_source_http (config->url, config->cert_pem);
+    s_sink = config->sink ? config->sink : wifi_ota_sink_flash();
+    s_running = true;
+    s_write_err = ESP_OK;
+    memset (&s_progress, 0, sizeof(s_progress));
+    s_progress.total = -1;
+
+    esp_err_t esp_ret = ota_pipeline_create ();
+    if (esp_ret != ESP_OK){
+        ESP_LOGE (TAG, "Failed to allocate OTA buffers");
+        ota_pipeline_delete ();
+        s_running = false;
+        return esp_ret;
+    }
+    esp_ret = s_sink->begin (s_sink->ctx);
+    if (esp_ret != ESP_OK){
+        ota_pipeline_delete ();
+        s_running = false;
+        return esp_ret;
+    }
+    mbedtls_sha256_init (&s_sha);
+    mbedtls_sha256_starts (&s_sha, 0);
+
+    s_receiver_task = xTaskGetCurrentTaskHandle();
+    if (xTaskCreate (ota_writer_task, "wifi_ota_wr", CONFIG_WIFI_OTA_WRITER_STACK_SIZE,
+                     NULL, CONFIG_WIFI_OTA_WRITER_PRIORITY, NULL) != pdPASS){
+        ESP_LOGE (TAG, "Failed to create OTA writer task");
+        s_sink->abort (s_sink->ctx);
+        mbedtls_sha256_free (&s_sha);
+        ota_pipeline_delete ();
+        s_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI (TAG, "Updating from %s", config->url);
+    // Resuming relies on the wifi_sta reconnect path: enable it while the update runs
+    bool reconnect_chosen = xEventGroupGetBits (e_wifi_event_group) & WIFI_CHOSEN_STA_RECONENCT;
+    xEventGroupSetBits (e_wifi_event_group, WIFI_CHOSEN_STA_RECONENCT);
+    ota_buffer_t *current = NULL;
+    while (1){
+        // The wifi_sta reconnect path sets the IPv4 bit again after a lost link
+        EventBits_t uxBit = xEventGroupWaitBits (e_wifi_event_group,
+                                                 WIFI_STA_IPV4_OBTAINED_BIT,
+                                                 pdFALSE,
+                                                 pdTRUE,
+                                                 pdMS_TO_TICKS(CONFIG_WIFI_OTA_RECONNECT_TIMEOUT_MS));
+        if (!(uxBit & WIFI_STA_IPV4_OBTAINED_BIT)){
+            ESP_LOGE (TAG, "Network not available");
+            esp_ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+        esp_ret = ota_download (source, &current);
+        if (esp_ret != ESP_ERR_NOT_FINISHED){
+            break;
+        }
+        if (s_progress.resumes >= CONFIG_WIFI_OTA_MAX_RESUMES){
+            ESP_LOGE (TAG, "Too many interrupted downloads");
+            esp_ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+        s_progress.resumes++;
+        ESP_LOGW (TAG, "Download interrupted, resume at %u bytes", (unsigned) s_progress.received);
+        // Give the disconnect event time to clear the IPv4 bit
+        vTaskDelay (pdMS_TO_TICKS(CONFIG_WIFI_OTA_RESUME_DELAY_MS));
+    }
+
+    if (!reconnect_chosen){
+        xEventGroupClearBits (e_wifi_event_group, WIFI_CHOSEN_STA_RECONENCT);
+    }
+
+    // Write the last partial buffer and wait for the writer to drain
+    if (esp_ret == ESP_OK && current != NULL && current->len > 0){
+        xQueueSend (s_full_queue, &current, portMAX_DELAY);
+    }
+    ota_buffer_t *stop = NULL;
+    xQueueSend (s_full_queue, &stop, portMAX_DELAY);
+    ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+    if (esp_ret == ESP_OK){
+        esp_ret = s_write_err;
+    }
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish (&s_sha, digest);
+    mbedtls_sha256_free (&s_sha);
+    if (esp_ret == ESP_OK && config->sha256 != NULL && memcmp (digest, config->sha256, sizeof(digest)) != 0){
+        ESP_LOGE (TAG, "Image SHA-256 mismatch");
+        esp_ret = ESP_ERR_INVALID_CRC;
+    }
+
+    if (esp_ret == ESP_OK){
+        esp_ret = s_sink->end (s_sink->ctx);
+        if (esp_ret != ESP_OK){
+            ESP_LOGE (TAG, "ERROR (%d): Failed to validate or select new image", esp_ret);
+        }
+        else {
+            ESP_LOGI (TAG, "Update done: %u bytes, %d resumes", (unsigned) s_progress.written, s_progress.resumes);
+        }
+    }
+    else {
+        s_sink->abort (s_sink->ctx);
+    }
+    ota_pipeline_delete ();
+    s_running = false;
+    return esp_ret;
+}
+
+esp_err_t wifi_ota_get_progress(wifi_ota_progress_t *progress)
+{
+    if (progress == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL (&s_progress_lock);
+    *progress = s_progress;
+    portEXIT_CRITICAL (&s_progress_lock);
+    return ESP_OK;
+}
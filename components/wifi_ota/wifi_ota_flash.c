@@ -0,0 +1,91 @@
+#include "wifi_ota.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+// Tag for debug messages
+static const char* TAG = "WIFI_OTA_FLASH";
+
+/**
+ * @brief State of the OTA partition sink
+ */
+typedef struct {
+    const esp_partition_t *partition;
+    esp_ota_handle_t handle;
+} ota_flash_t;
+
+// Static global variables
+static ota_flash_t s_flash;
+
+/******************************
+ * Private functions prototypes
+ */
+
+static esp_err_t ota_flash_begin (void *ctx);
+
+static esp_err_t ota_flash_write (void *ctx, const uint8_t *data, size_t len);
+
+static esp_err_t ota_flash_end (void *ctx);
+
+static void ota_flash_abort (void *ctx);
+
+static const wifi_ota_sink_t s_flash_sink = {
+    .begin = ota_flash_begin,
+    .write = ota_flash_write,
+    .end = ota_flash_end,
+    .abort = ota_flash_abort,
+    .ctx = &s_flash,
+};
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+static esp_err_t ota_flash_begin (void *ctx)
+{
+    ota_flash_t *flash = (ota_flash_t*) ctx;
+    flash->partition = esp_ota_get_next_update_partition (NULL);
+    if (flash->partition == NULL){
+        ESP_LOGE (TAG, "No OTA partition to update");
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t esp_ret = esp_ota_begin (flash->partition, OTA_WITH_SEQUENTIAL_WRITES, &flash->handle);
+    if (esp_ret != ESP_OK){
+        ESP_LOGE (TAG, "ERROR (%d): Failed to begin OTA on %s", esp_ret, flash->partition->label);
+        return esp_ret;
+    }
+    ESP_LOGI (TAG, "Writing partition %s", flash->partition->label);
+    return ESP_OK;
+}
+
+static esp_err_t ota_flash_write (void *ctx, const uint8_t *data, size_t len)
+{
+    ota_flash_t *flash = (ota_flash_t*) ctx;
+    return esp_ota_write (flash->handle, data, len);
+}
+
+static esp_err_t ota_flash_end (void *ctx)
+{
+    ota_flash_t *flash = (ota_flash_t*) ctx;
+    esp_err_t esp_ret = esp_ota_end (flash->handle);
+    if (esp_ret == ESP_OK){
+        esp_ret = esp_ota_set_boot_partition (flash->partition);
+    }
+    return esp_ret;
+}
+
+static void ota_flash_abort (void *ctx)
+{
+    ota_flash_t *flash = (ota_flash_t*) ctx;
+    esp_ota_abort (flash->handle);
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+const wifi_ota_sink_t *wifi_ota_sink_flash(void)
+{
+    return &s_flash_sink;
+}
@@ -0,0 +1,144 @@
+#include "wifi_ota.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include <stdio.h>
+// Tag for debug messages
+static const char* TAG = "WIFI_OTA_HTTP";
+
+// Redirects followed per request, then the 3xx status is reported as is
+#define OTA_HTTP_MAX_REDIRECTS  5
+
+/**
+ * @brief State of the HTTP image source
+ */
+typedef struct {
+    const char *url;
+    const char *cert_pem;
+    esp_http_client_handle_t client;
+} ota_http_t;
+
+// Static global variables
+static ota_http_t s_http;
+static wifi_ota_source_t s_http_source;
+
+/******************************
+ * Private functions prototypes
+ */
+
+static bool ota_http_is_redirect (int status);
+
+static esp_err_t ota_http_open (void *ctx, size_t offset, int *status, int64_t *content_length);
+
+static int ota_http_read (void *ctx, uint8_t *buf, size_t len);
+
+static bool ota_http_is_complete (void *ctx);
+
+static void ota_http_close (void *ctx);
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+static bool ota_http_is_redirect (int status)
+{
+    return status == HttpStatus_MovedPermanently || status == HttpStatus_Found ||
+           status == HttpStatus_SeeOther || status == HttpStatus_TemporaryRedirect ||
+           status == HttpStatus_PermanentRedirect;
+}
+
+static esp_err_t ota_http_open (void *ctx, size_t offset, int *status, int64_t *content_length)
+{
+    ota_http_t *http = (ota_http_t*) ctx;
+    esp_http_client_config_t http_config = {
+        .url = http->url,
+        .cert_pem = http->cert_pem,
+        .crt_bundle_attach = (http->cert_pem == NULL) ? esp_crt_bundle_attach : NULL,
+        .timeout_ms = CONFIG_WIFI_OTA_HTTP_TIMEOUT_MS,
+        .keep_alive_enable = true,
+    };
+    http->client = esp_http_client_init (&http_config);
+    if (http->client == NULL){
+        ESP_LOGE (TAG, "Failed to initialize HTTP client");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Ask only for the missing part of the image
+    if (offset > 0){
+        char range[32];
+        snprintf (range, sizeof(range), "bytes=%u-", (unsigned) offset);
+        esp_http_client_set_header (http->client, "Range", range);
+    }
+    // esp_http_client_open() does not follow redirects: take the Location and ask again,
+    // the Range header is kept for the new URL
+    for (int redirects = 0; ; redirects++){
+        esp_err_t esp_ret = esp_http_client_open (http->client, 0);
+        if (esp_ret != ESP_OK){
+            ESP_LOGW (TAG, "Failed to open %s", http->url);
+            ota_http_close (http);
+            return esp_ret;
+        }
+        *content_length = esp_http_client_fetch_headers (http->client);
+        *status = esp_http_client_get_status_code (http->client);
+        if (*status <= 0){
+            // Connection lost before the response headers: can be resumed
+            ESP_LOGW (TAG, "No response from %s", http->url);
+            ota_http_close (http);
+            return ESP_FAIL;
+        }
+        if (!ota_http_is_redirect (*status) || redirects == OTA_HTTP_MAX_REDIRECTS){
+            break;
+        }
+        // Drain the redirect body so the connection can be reused
+        esp_http_client_flush_response (http->client, NULL);
+        if (esp_http_client_set_redirection (http->client) != ESP_OK){
+            ESP_LOGE (TAG, "HTTP status %d without a valid Location", *status);
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+static int ota_http_read (void *ctx, uint8_t *buf, size_t len)
+{
+    ota_http_t *http = (ota_http_t*) ctx;
+    return esp_http_client_read (http->client, (char*) buf, len);
+}
+
+static bool ota_http_is_complete (void *ctx)
+{
+    ota_http_t *http = (ota_http_t*) ctx;
+    return esp_http_client_is_complete_data_received (http->client);
+}
+
+static void ota_http_close (void *ctx)
+{
+    ota_http_t *http = (ota_http_t*) ctx;
+    if (http->client != NULL){
+        esp_http_client_close (http->client);
+        esp_http_client_cleanup (http->client);
+        http->client = NULL;
+    }
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+const wifi_ota_source_t *wifi_ota_source_http(const char *url, const char *cert_pem)
+{
+    s_http.url = url;
+    s_http.cert_pem = cert_pem;
+    s_http.client = NULL;
+    s_http_source = (wifi_ota_source_t) {
+        .open = ota_http_open,
+        .read = ota_http_read,
+        .is_complete = ota_http_is_complete,
+        .close = ota_http_close,
+        .ctx = &s_http,
+    };
+    return &s_http_source;
+}
@@ -13,6 +13,8 @@ extern EventGroupHandle_t e_wifi_event_group;
 #define WIFI_STA_CONNECTED_BIT  BIT0
 #define WIFI_STA_DISCONNECT     BIT1
 #define WIFI_STA_STOP           BIT2
+#define WIFI_STA_HEALTH_RECOVER BIT3    // Link health monitor reconnecting, cleared on IP_EVENT_STA_GOT_IP
+#define WIFI_STA_HEALTH_WAKE    BIT4    // Wakes the link health monitor task (stop)
 
 #define WIFI_STA_SCAN_INIT      BIT10
 #define WIFI_STA_SCAN_START     BIT11
@@ -32,6 +34,7 @@ extern EventGroupHandle_t e_wifi_event_group;
 /**
  * @brief Initialize Wifi in station (STA) mode
  * Set up the WiFi interface and connection and IP address assignment
+ * Buffer and AMPDU settings follow the profile chosen with wifi_sta_profile_set (wifi_sta_profile.h).
  * !! You must call esp_netif_init() and esp_event_loop_create_default() before call this function.
  * 
  * @param[in] event_group Event group handle for WiFi and IP events. 
@@ -53,6 +56,25 @@ esp_err_t wifi_sta_init (EventGroupHandle_t event_group);
 
  esp_err_t wifi_sta_stop(void);
 
+/**
+ * @brief Get the WiFi station network interface
+ *
+ * @return Interface handle, NULL if wifi_sta_init is not called
+ */
+esp_netif_t *wifi_sta_get_netif(void);
+
+/**
+ * @brief Get the gateway address learned from DHCP
+ *
+ * @param[out] gateway Gateway IPv4 address
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_ARG : gateway is NULL
+ * - ESP_ERR_INVALID_STATE : No IPv4 address obtained
+ */
+esp_err_t wifi_sta_get_gateway(esp_ip4_addr_t *gateway);
+
  /**
   * @brief Scan Wifi in station mode (STA) mode
   * Scan all avaliable Wifi (Except hidden WiFI) 
@@ -75,4 +97,48 @@ esp_err_t wifi_sta_scan_read(wifi_ap_record_t **ap_record);
 bool is_wifi_sta_scan_done();
 bool is_wifi_sta_scan_start();
 
+// Channel mask: one bit per primary channel number 0-255, 2.4 GHz (1-14) and 5 GHz (36-177)
+#define WIFI_STA_SCAN_CHANNEL_WORDS         8
+#define WIFI_STA_SCAN_CHANNEL_SET(mask, channel)    ((mask)[(channel) / 32] |= 1UL << ((channel) % 32))
+#define WIFI_STA_SCAN_CHANNEL_IS_SET(mask, channel) (((mask)[(channel) / 32] >> ((channel) % 32)) & 1UL)
+
+/**
+ * @brief Filter and rank options for scanned APs
+ * Stages run in this order: match (SSID, auth mode, channel, RSSI) -> dedupe -> top-K
+ */
+typedef struct {
+    const char *ssid;               // Keep only this SSID (NULL: any SSID)
+    wifi_auth_mode_t min_authmode;  // Drop APs with a lower auth mode value
+    uint32_t channel_mask[WIFI_STA_SCAN_CHANNEL_WORDS]; // Keep only channels set in the mask (all 0: any channel)
+    int8_t rssi_floor;              // Drop APs weaker than this RSSI (dBm)
+    bool dedupe_ssid;               // Keep only the strongest BSSID of each SSID
+    uint16_t top_k;                 // Keep the K strongest APs sorted by RSSI (0: keep all, unsorted)
+} wifi_sta_scan_filter_t;
+
+#define WIFI_STA_SCAN_FILTER_DEFAULT() {    \
+        .ssid = NULL,                       \
+        .min_authmode = WIFI_AUTH_OPEN,     \
+        .channel_mask = {0},                \
+        .rssi_floor = -127,                 \
+        .dedupe_ssid = false,               \
+        .top_k = 0                          \
+    }
+
+/**
+ * @brief Filter, dedupe and rank scanned APs in place
+ * Works directly on the array filled by wifi_sta_scan_read, no memory is allocated.
+ * Kept records are moved to the front of the array and ap_num is updated.
+ *
+ * @param[in,out] ap_record Array of scanned APs
+ * @param[in,out] ap_num Number of records in the array, number of kept records on return
+ * @param[in] filter Filter options (see WIFI_STA_SCAN_FILTER_DEFAULT)
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_ARG : If an argument is NULL
+ */
+esp_err_t wifi_sta_scan_filter(wifi_ap_record_t *ap_record,
+                               uint16_t *ap_num,
+                               const wifi_sta_scan_filter_t *filter);
+
 #endif // WIFI_STA_H
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef WIFI_STA_HEALTH_H
+#define WIFI_STA_HEALTH_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief Rolling link statistics
+ * Averages are exponentially weighted (1/8 per probe).
+ */
+typedef struct {
+    bool running;               // Monitor started, the other fields are meaningless otherwise
+    bool healthy;               // Last probe answered and link within thresholds
+    int8_t rssi;                // Last RSSI of the associated AP (dBm)
+    int8_t rssi_avg;            // Average RSSI (dBm)
+    uint32_t rtt_last_ms;       // Last gateway round-trip time
+    uint32_t rtt_avg_ms;        // Average gateway round-trip time
+    uint32_t probes_sent;
+    uint32_t probes_lost;       // No echo reply before the probe timeout
+    uint32_t tx_failures;       // Probe could not be sent
+    uint8_t loss_percent;       // Loss over the last 32 probes
+    uint8_t consecutive_lost;
+    uint32_t dhcp_renewals;     // Recovery actions taken
+    uint32_t reconnects;
+    uint32_t interval_ms;       // Current probe interval
+} wifi_sta_health_stats_t;
+
+/**
+ * @brief Start the link health monitor
+ * Probes the gateway learned from DHCP with ICMP echo while an IPv4 address is held.
+ * Renews DHCP, then reconnects, when probes keep failing. After a reconnect it keeps
+ * retrying, backing off up to the maximum interval, until an address is obtained.
+ * The monitor runs in its own task rather than an esp_timer callback: a probe blocks
+ * for up to CONFIG_WIFI_STA_HEALTH_PROBE_TIMEOUT_MS, too long for the timer task.
+ * !! You must call wifi_sta_init() before call this function.
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_STATE : Already started or WiFi not initialized
+ * - ESP_ERR_NO_MEM : Failed to create the monitor task
+ */
+esp_err_t wifi_sta_health_start(void);
+
+/**
+ * @brief Stop the link health monitor
+ * A reconnect in progress is no longer retried.
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_STATE : Not started
+ */
+esp_err_t wifi_sta_health_stop(void);
+
+/**
+ * @brief Copy the current link statistics
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_ARG : stats is NULL
+ */
+esp_err_t wifi_sta_health_get_stats(wifi_sta_health_stats_t *stats);
+
+/**
+ * @brief Tell the monitor the application is using the link
+ * Probing runs at the minimum interval while the link is busy and
+ * backs off towards the maximum interval while it is idle.
+ */
+void wifi_sta_health_notify_activity(void);
+
+#endif // WIFI_STA_HEALTH_H
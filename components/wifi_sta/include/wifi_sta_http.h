@@ -0,0 +1,47 @@
+#ifndef WIFI_STA_HTTP_H
+#define WIFI_STA_HTTP_H
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+
+/**
+ * @brief Start the local HTTP server
+ * Serves JSON streamed in chunks from a CONFIG_WIFI_STA_HTTP_CHUNK_SIZE buffer:
+ * - GET /scan   : last published scan results
+ * - GET /status : connection state, IP info and link health statistics
+ * !! You must call wifi_sta_init() before call this function.
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_STATE : Already started
+ * - Other errors from esp_http_server
+ */
+esp_err_t wifi_sta_http_start(void);
+
+/**
+ * @brief Stop the local HTTP server
+ * Published scan results are released (freed once no response reads them).
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_STATE : Not started
+ */
+esp_err_t wifi_sta_http_stop(void);
+
+/**
+ * @brief Publish scan results for GET /scan
+ * The records are not copied: the server takes ownership of the malloc'd array and
+ * frees it once replaced (next call, or a call with NULL) and no response reads it.
+ * Never waits for a client being served.
+ *
+ * @param[in] ap_record Array of scanned APs allocated with malloc, NULL to clear
+ * @param[in] ap_num Number of records
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_STATE : Server not started (the array is not taken)
+ * - ESP_ERR_NO_MEM : Out of memory (the array is not taken)
+ */
+esp_err_t wifi_sta_http_set_scan(wifi_ap_record_t *ap_record, uint16_t ap_num);
+
+#endif // WIFI_STA_HTTP_H
@@ -0,0 +1,81 @@
+#ifndef WIFI_STA_JSON_H
+#define WIFI_STA_JSON_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+
+/**
+ * @brief Maximum nesting of objects and arrays
+ */
+#define WIFI_STA_JSON_MAX_DEPTH     32
+
+/**
+ * @brief Output callback, called each time the buffer is full and on finish
+ *
+ * @return ESP_OK to continue, any error stops the encoder
+ */
+typedef esp_err_t (*wifi_sta_json_flush_t)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Streaming JSON encoder
+ * Writes into a caller-owned fixed buffer and flushes it when full,
+ * so memory use does not depend on the document size.
+ * Errors are sticky: after a failed flush every call is a no-op and
+ * wifi_sta_json_finish() returns the error.
+ */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    wifi_sta_json_flush_t flush;
+    void *ctx;
+    uint8_t depth;
+    uint32_t has_member;    // Bit n: level n already has a member (a comma is needed)
+    size_t total;           // Bytes produced so far
+    esp_err_t err;
+} wifi_sta_json_t;
+
+/**
+ * @brief Initialize an encoder over a fixed buffer
+ *
+ * @param[out] json Encoder
+ * @param[in] buf Output buffer
+ * @param[in] size Buffer size
+ * @param[in] flush Output callback
+ * @param[in] ctx Passed to the output callback
+ */
+void wifi_sta_json_init(wifi_sta_json_t *json, char *buf, size_t size,
+                        wifi_sta_json_flush_t flush, void *ctx);
+
+/**
+ * @brief Containers and values
+ * key is the member name inside an object, NULL inside an array or at the root.
+ * Strings end at a NUL or after max_len bytes. Bytes that are not valid UTF-8 are
+ * written as \u00XX, so any SSID gives valid JSON.
+ */
+void wifi_sta_json_object_begin(wifi_sta_json_t *json, const char *key);
+void wifi_sta_json_object_end(wifi_sta_json_t *json);
+void wifi_sta_json_array_begin(wifi_sta_json_t *json, const char *key);
+void wifi_sta_json_array_end(wifi_sta_json_t *json);
+void wifi_sta_json_string(wifi_sta_json_t *json, const char *key, const char *value, size_t max_len);
+void wifi_sta_json_int(wifi_sta_json_t *json, const char *key, int64_t value);
+void wifi_sta_json_bool(wifi_sta_json_t *json, const char *key, bool value);
+
+/**
+ * @brief Encode one scanned AP as an object (ssid, bssid, channel, rssi, authmode)
+ */
+void wifi_sta_json_ap_record(wifi_sta_json_t *json, const char *key, const wifi_ap_record_t *ap_record);
+
+/**
+ * @brief Flush the remaining output
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_STATE : Unbalanced or too deep containers
+ * - Error returned by the output callback
+ */
+esp_err_t wifi_sta_json_finish(wifi_sta_json_t *json);
+
+#endif // WIFI_STA_JSON_H
@@ -0,0 +1,107 @@
+#ifndef WIFI_STA_PROFILE_H
+#define WIFI_STA_PROFILE_H
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+
+/**
+ * @brief WiFi init profiles
+ */
+typedef enum {
+    WIFI_STA_PROFILE_HIGH_THROUGHPUT = 0,   // Large buffer pools and block ack window, no power save
+    WIFI_STA_PROFILE_BALANCED,              // ESP-IDF WiFi settings from menuconfig
+    WIFI_STA_PROFILE_LOW_MEMORY,            // Minimum buffers, no AMPDU TX
+    WIFI_STA_PROFILE_MAX,
+} wifi_sta_profile_t;
+
+/**
+ * @brief Heap cost and throughput of the active profile
+ * The heap figures are free sizes sampled around WiFi init and during the test:
+ * allocations of other tasks running meanwhile are counted as well, such as
+ * bootstrap steps that do not depend on BOOTSTRAP_WIFI_STA.
+ * Measure with nothing else running for the cost of the profile alone.
+ */
+typedef struct {
+    wifi_sta_profile_t profile;
+    size_t internal_before;     // Free internal heap before esp_wifi_init
+    size_t internal_after;      // Free internal heap after esp_wifi_start
+    size_t internal_min;        // Lowest free internal heap seen during the throughput test
+    size_t psram_before;        // Free PSRAM before esp_wifi_init (0 without PSRAM)
+    size_t psram_after;         // Free PSRAM after esp_wifi_start
+    uint64_t rx_bytes;          // Bytes received by the throughput test
+    uint32_t duration_ms;       // Duration of the throughput test
+    uint32_t rx_kbps;           // Receive throughput (kbit/s), TX is not measured
+} wifi_sta_profile_report_t;
+
+/**
+ * @brief Select the profile used by wifi_sta_init (default: CONFIG_WIFI_STA_PROFILE)
+ * !! You must call this function before wifi_sta_init().
+ * WiFi and LWIP buffers in PSRAM are a build option (CONFIG_SPIRAM_TRY_ALLOCATE_WIFI_LWIP),
+ * implied by the low memory Kconfig choice only: selecting it here does not enable them.
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_ARG : Unknown profile
+ * - ESP_ERR_INVALID_STATE : WiFi already initialized
+ */
+esp_err_t wifi_sta_profile_set(wifi_sta_profile_t profile);
+
+/**
+ * @brief Get the selected profile
+ */
+wifi_sta_profile_t wifi_sta_profile_get(void);
+
+/**
+ * @brief Get the name of a profile
+ */
+const char *wifi_sta_profile_name(wifi_sta_profile_t profile);
+
+/**
+ * @brief Fill the init config from the selected profile and record the free heap
+ * (called by wifi_sta_init before esp_wifi_init)
+ *
+ * @param[in,out] cfg Config from WIFI_INIT_CONFIG_DEFAULT()
+ */
+void wifi_sta_profile_apply(wifi_init_config_t *cfg);
+
+/**
+ * @brief Apply the runtime settings of the profile and record the heap cost
+ * (called by wifi_sta_init after esp_wifi_start)
+ *
+ * @return
+ * - ESP_OK : On success
+ * - Other errors from esp_wifi_set_ps
+ */
+esp_err_t wifi_sta_profile_finish(void);
+
+/**
+ * @brief Copy the heap cost recorded by wifi_sta_init and the last throughput test
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_ARG : report is NULL
+ */
+esp_err_t wifi_sta_profile_get_report(wifi_sta_profile_report_t *report);
+
+/**
+ * @brief Measure the receive throughput of the active profile
+ * Accepts one TCP connection on port and counts the bytes received for duration_ms
+ * or until the peer closes. Send data from a host with "iperf -c <device IP> -p <port>".
+ * Receive only: the TX settings of the profile (TX buffers, AMPDU TX, A-MSDU) are not exercised.
+ * The result is logged together with the heap cost.
+ * !! The station must have an IPv4 address.
+ *
+ * @param port TCP port to listen on
+ * @param duration_ms Test duration
+ * @param[out] report Heap cost and throughput, may be NULL
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_TIMEOUT : No connection within 60 s
+ * - ESP_ERR_NO_MEM : Out of memory
+ * - ESP_FAIL : Socket error
+ */
+esp_err_t wifi_sta_profile_measure(uint16_t port, uint32_t duration_ms, wifi_sta_profile_report_t *report);
+
+#endif // WIFI_STA_PROFILE_H
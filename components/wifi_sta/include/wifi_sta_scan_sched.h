@@ -0,0 +1,80 @@
+#ifndef WIFI_STA_SCAN_SCHED_H
+#define WIFI_STA_SCAN_SCHED_H
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+
+/**
+ * @brief Why the scan period was chosen
+ */
+typedef enum {
+    WIFI_STA_SCAN_SCHED_FIRST = 0,      // No previous scan to compare with
+    WIFI_STA_SCAN_SCHED_STABLE,         // Low churn: period stretched
+    WIFI_STA_SCAN_SCHED_HOLD,           // Moderate churn: period kept
+    WIFI_STA_SCAN_SCHED_CHURN,          // High churn: period reset to minimum
+    WIFI_STA_SCAN_SCHED_DISCONNECT,     // Station disconnected: period reset to minimum
+} wifi_sta_scan_sched_reason_t;
+
+/**
+ * @brief One scheduler decision
+ */
+typedef struct {
+    int64_t timestamp_us;               // esp_timer time of the decision
+    uint16_t ap_num;                    // APs above the RSSI floor in this scan
+    uint8_t appeared;                   // APs not in the previous scan
+    uint8_t disappeared;                // APs of the previous scan that are gone
+    uint16_t rssi_variance;             // Mean squared RSSI change of the remaining APs (dB^2)
+    uint8_t churn;                      // Churn score 0 (static) to 100
+    wifi_sta_scan_sched_reason_t reason;
+    uint32_t period_ms;                 // Period until the next scan
+} wifi_sta_scan_sched_entry_t;
+
+/**
+ * @brief Initialize the scan scheduler
+ *
+ * @param min_period_ms Period used while the environment changes (0: CONFIG_WIFI_STA_SCAN_SCHED_MIN_MS)
+ * @param max_period_ms Longest period for a stable environment (0: CONFIG_WIFI_STA_SCAN_SCHED_MAX_MS)
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_INVALID_ARG : min_period_ms is larger than max_period_ms
+ */
+esp_err_t wifi_sta_scan_sched_init(uint32_t min_period_ms, uint32_t max_period_ms);
+
+/**
+ * @brief Compare a scan with the previous one and choose the next period
+ * Pass the unfiltered result of wifi_sta_scan_read.
+ * Only the CONFIG_WIFI_STA_SCAN_SCHED_MAX_AP strongest APs are remembered; APs
+ * left out of either scan are not counted as appeared or gone.
+ * The period doubles while churn stays below CONFIG_WIFI_STA_SCAN_SCHED_CHURN_LOW
+ * and snaps back to the minimum above CONFIG_WIFI_STA_SCAN_SCHED_CHURN_HIGH.
+ *
+ * @param[in] ap_record Array of scanned APs
+ * @param[in] ap_num Number of records
+ *
+ * @return Period until the next scan (ms)
+ */
+uint32_t wifi_sta_scan_sched_update(const wifi_ap_record_t *ap_record, uint16_t ap_num);
+
+/**
+ * @brief Reset the period to the minimum
+ * Called by wifi_sta when an established link is lost, not for failed connect attempts.
+ */
+void wifi_sta_scan_sched_notify_disconnect(void);
+
+/**
+ * @brief Get the current scan period (ms)
+ */
+uint32_t wifi_sta_scan_sched_get_period(void);
+
+/**
+ * @brief Copy the latest decisions, oldest first
+ *
+ * @param[out] history Output array
+ * @param[in] max_entries Size of the output array
+ *
+ * @return Number of entries copied (at most CONFIG_WIFI_STA_SCAN_SCHED_HISTORY)
+ */
+uint16_t wifi_sta_scan_sched_get_history(wifi_sta_scan_sched_entry_t *history, uint16_t max_entries);
+
+#endif // WIFI_STA_SCAN_SCHED_H
@@ -0,0 +1,145 @@
+#ifndef WIFI_STA_TRACE_H
+#define WIFI_STA_TRACE_H
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/**
+ * @brief Trace levels, selected at compile time with CONFIG_WIFI_STA_TRACE_LEVEL
+ * Trace calls above the selected level compile to nothing (arguments are not evaluated).
+ */
+#define WIFI_STA_TRACE_LEVEL_NONE       0
+#define WIFI_STA_TRACE_LEVEL_ERROR      1
+#define WIFI_STA_TRACE_LEVEL_INFO       2
+#define WIFI_STA_TRACE_LEVEL_VERBOSE    3
+
+/**
+ * @brief Event id = (source << 8) | id
+ * WIFI and IP sources carry the ESP-IDF event id unchanged.
+ */
+#define WIFI_STA_TRACE_SRC_WIFI     0x01
+#define WIFI_STA_TRACE_SRC_IP       0x02
+#define WIFI_STA_TRACE_SRC_STA      0x03
+#define WIFI_STA_TRACE_ID(src, id)  ((uint16_t)(((src) << 8) | ((id) & 0xFF)))
+
+/**
+ * @brief Component events and their payload (arg0, arg1)
+ * Keep in sync with tools/wifi_sta_trace_decode.py
+ */
+typedef enum {
+    WIFI_STA_TRACE_CONNECTED    = WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_STA, 0x01), // channel | authmode << 8 | aid << 16, bssid[2..5]
+    WIFI_STA_TRACE_GOT_IP       = WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_STA, 0x02), // ip, gateway
+    WIFI_STA_TRACE_NETMASK      = WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_STA, 0x03), // netmask, 0
+    WIFI_STA_TRACE_SCAN_NUM     = WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_STA, 0x04), // ap_num, 0
+    WIFI_STA_TRACE_SCAN_AP      = WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_STA, 0x05), // index | channel << 8 | authmode << 16 | rssi << 24, bssid[2..5]
+    WIFI_STA_TRACE_RECONNECT    = WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_STA, 0x06), // reconnect count, esp_err_t
+    WIFI_STA_TRACE_HEALTH_PROBE = WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_STA, 0x07), // rtt_ms (UINT32_MAX: lost), rssi
+    WIFI_STA_TRACE_HEALTH_RECOVER = WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_STA, 0x08), // action (1: DHCP renew, 2: reconnect), consecutive lost; (3: retry), attempt
+    WIFI_STA_TRACE_SCAN_SCHED   = WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_STA, 0x09), // churn | reason << 8, period_ms
+    WIFI_STA_TRACE_AP_ID        = WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_STA, 0x0A), // bssid[0..1] | ssid_len << 16, FNV-1a hash of the SSID
+    WIFI_STA_TRACE_AP_SSID      = WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_STA, 0x0B), // ssid[n..n+3], ssid[n+4..n+7]
+} wifi_sta_trace_event_t;
+
+/**
+ * @brief Fixed-size trace record (16 bytes, little endian in dumps)
+ */
+typedef struct {
+    uint32_t timestamp_us;  // Low 32 bits of esp_timer_get_time()
+    uint8_t core;           // Core that wrote the record
+    uint8_t level;          // WIFI_STA_TRACE_LEVEL_x
+    uint16_t event_id;      // WIFI_STA_TRACE_ID(source, id)
+    uint32_t arg0;
+    uint32_t arg1;
+} wifi_sta_trace_record_t;
+
+/**
+ * @brief Dump header, followed by record_count records from oldest to newest
+ */
+typedef struct {
+    uint32_t magic;         // WIFI_STA_TRACE_MAGIC
+    uint16_t version;       // WIFI_STA_TRACE_VERSION
+    uint16_t record_size;   // sizeof(wifi_sta_trace_record_t)
+    uint32_t record_count;
+    uint32_t dropped;       // Records overwritten or lost while dumping
+} wifi_sta_trace_header_t;
+
+#define WIFI_STA_TRACE_MAGIC    0x52545357  // "WSTR"
+#define WIFI_STA_TRACE_VERSION  1
+
+/**
+ * @brief Write one record into the RAM ring buffer
+ * No formatting is done, safe to call from tasks and ISRs.
+ * Use the WIFI_STA_TRACE_x macros so disabled levels cost nothing.
+ */
+void wifi_sta_trace_write(uint8_t level, uint16_t event_id, uint32_t arg0, uint32_t arg1);
+
+/**
+ * @brief Write an AP event (CONNECTED, SCAN_AP) followed by the AP identity
+ * arg1 of the event holds bssid[2..5]. It is followed by one WIFI_STA_TRACE_AP_ID record and
+ * one WIFI_STA_TRACE_AP_SSID record per 8 SSID bytes. All are written at once, so the decoder
+ * finds them next to each other.
+ */
+void wifi_sta_trace_write_ap(uint8_t level, uint16_t event_id, uint32_t arg0,
+                             const uint8_t bssid[6], const uint8_t *ssid, size_t ssid_max_len);
+
+/**
+ * @brief Dump the ring buffer to the console as "WSTRACE <hex>" lines
+ * Decode the captured log with tools/wifi_sta_trace_decode.py
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_NOT_SUPPORTED : Trace is disabled
+ */
+esp_err_t wifi_sta_trace_dump_uart(void);
+
+/**
+ * @brief Dump the ring buffer to the data partition CONFIG_WIFI_STA_TRACE_PARTITION_LABEL
+ * Read it back with "parttool.py read_partition" and decode the binary file.
+ *
+ * @return
+ * - ESP_OK : On success
+ * - ESP_ERR_NOT_FOUND : Partition not found
+ * - ESP_ERR_NOT_SUPPORTED : Trace is disabled
+ * - Other errors from esp_partition
+ */
+esp_err_t wifi_sta_trace_dump_flash(void);
+
+/**
+ * @brief Drop all records
+ */
+void wifi_sta_trace_clear(void);
+
+#if CONFIG_WIFI_STA_TRACE_LEVEL >= WIFI_STA_TRACE_LEVEL_ERROR
+#define WIFI_STA_TRACE_E(event_id, arg0, arg1)  wifi_sta_trace_write(WIFI_STA_TRACE_LEVEL_ERROR, (event_id), (uint32_t)(arg0), (uint32_t)(arg1))
+#else
+#define WIFI_STA_TRACE_E(event_id, arg0, arg1)  do { (void) sizeof ((event_id) + (arg0) + (arg1)); } while (0)
+#endif
+
+#if CONFIG_WIFI_STA_TRACE_LEVEL >= WIFI_STA_TRACE_LEVEL_INFO
+#define WIFI_STA_TRACE_I(event_id, arg0, arg1)  wifi_sta_trace_write(WIFI_STA_TRACE_LEVEL_INFO, (event_id), (uint32_t)(arg0), (uint32_t)(arg1))
+#else
+#define WIFI_STA_TRACE_I(event_id, arg0, arg1)  do { (void) sizeof ((event_id) + (arg0) + (arg1)); } while (0)
+#endif
+
+#if CONFIG_WIFI_STA_TRACE_LEVEL >= WIFI_STA_TRACE_LEVEL_VERBOSE
+#define WIFI_STA_TRACE_V(event_id, arg0, arg1)  wifi_sta_trace_write(WIFI_STA_TRACE_LEVEL_VERBOSE, (event_id), (uint32_t)(arg0), (uint32_t)(arg1))
+#else
+#define WIFI_STA_TRACE_V(event_id, arg0, arg1)  do { (void) sizeof ((event_id) + (arg0) + (arg1)); } while (0)
+#endif
+
+#if CONFIG_WIFI_STA_TRACE_LEVEL >= WIFI_STA_TRACE_LEVEL_INFO
+#define WIFI_STA_TRACE_AP_I(event_id, arg0, bssid, ssid)    \
+        wifi_sta_trace_write_ap(WIFI_STA_TRACE_LEVEL_INFO, (event_id), (uint32_t)(arg0), (bssid), (ssid), sizeof(ssid))
+#else
+#define WIFI_STA_TRACE_AP_I(event_id, arg0, bssid, ssid)    do { (void) sizeof ((event_id) + (arg0) + (bssid)[0] + (ssid)[0]); } while (0)
+#endif
+
+#if CONFIG_WIFI_STA_TRACE_LEVEL >= WIFI_STA_TRACE_LEVEL_VERBOSE
+#define WIFI_STA_TRACE_AP_V(event_id, arg0, bssid, ssid)    \
+        wifi_sta_trace_write_ap(WIFI_STA_TRACE_LEVEL_VERBOSE, (event_id), (uint32_t)(arg0), (bssid), (ssid), sizeof(ssid))
+#else
+#define WIFI_STA_TRACE_AP_V(event_id, arg0, bssid, ssid)    do { (void) sizeof ((event_id) + (arg0) + (bssid)[0] + (ssid)[0]); } while (0)
+#endif
+
+#endif // WIFI_STA_TRACE_H
@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+"""Decode a wifi_sta binary trace dump into a readable timeline.
+
+Input is either:
+  - a console log captured while calling wifi_sta_trace_dump_uart() ("WSTRACE <hex>" lines)
+  - a binary partition image written by wifi_sta_trace_dump_flash(), e.g.
+    parttool.py read_partition --partition-name trace --output trace.bin
+
+Usage: wifi_sta_trace_decode.py <dump file>
+Record layout must match include/wifi_sta_trace.h.
+"""
+import argparse
+import ipaddress
+import struct
+import sys
+
+MAGIC = 0x52545357  # "WSTR"
+VERSION = 1
+HEADER = struct.Struct("<IHHII")   # magic, version, record_size, record_count, dropped
+RECORD = struct.Struct("<IBBHII")  # timestamp_us, core, level, event_id, arg0, arg1
+
+LEVELS = {1: "E", 2: "I", 3: "V"}
+
+SRC_WIFI = 0x01
+SRC_IP = 0x02
+SRC_STA = 0x03
+
+WIFI_EVENTS = [
+    "WIFI_READY", "SCAN_DONE", "STA_START", "STA_STOP", "STA_CONNECTED",
+    "STA_DISCONNECTED", "STA_AUTHMODE_CHANGE", "STA_WPS_ER_SUCCESS",
+    "STA_WPS_ER_FAILED", "STA_WPS_ER_TIMEOUT", "STA_WPS_ER_PIN",
+    "STA_WPS_ER_PBC_OVERLAP", "AP_START", "AP_STOP", "AP_STACONNECTED",
+    "AP_STADISCONNECTED", "AP_PROBEREQRECVED", "FTM_REPORT",
+    "STA_BSS_RSSI_LOW", "ACTION_TX_STATUS", "ROC_DONE", "STA_BEACON_TIMEOUT",
+]
+
+IP_EVENTS = [
+    "STA_GOT_IP", "STA_LOST_IP", "AP_STAIPASSIGNED", "GOT_IP6",
+    "ETH_GOT_IP", "ETH_LOST_IP", "PPP_GOT_IP", "PPP_LOST_IP",
+]
+
+
+def ip4(value):
+    # esp_ip4_addr_t is stored in network order inside a little endian word
+    return str(ipaddress.IPv4Address(struct.pack("<I", value)))
+
+
+def bssid_tail(value):
+    return ":".join("%02x" % b for b in struct.pack("<I", value))
+
+
+def fmt_connected(arg0, arg1):
+    return "channel=%d authmode=%d aid=%d bssid=..:..:%s" % (
+        arg0 & 0xFF, (arg0 >> 8) & 0xFF, (arg0 >> 16) & 0xFFFF, bssid_tail(arg1))
+
+
+def fmt_scan_ap(arg0, arg1):
+    rssi = (arg0 >> 24) & 0xFF
+    if rssi >= 0x80:
+        rssi -= 0x100
+    return "index=%d channel=%d authmode=%d rssi=%d bssid=..:..:%s" % (
+        arg0 & 0xFF, (arg0 >> 8) & 0xFF, (arg0 >> 16) & 0xFF, rssi, bssid_tail(arg1))
+
+
+def ssid_hash(ssid):
+    # FNV-1a, same as wifi_sta_trace.c
+    value = 2166136261
+    for b in ssid:
+        value = ((value ^ b) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def fmt_ssid(ssid):
+    # SSIDs are arbitrary octets: keep printable ASCII, escape the rest
+    return "".join(chr(b) if 0x20 <= b < 0x7F and b not in (0x22, 0x5C) else "\\x%02x" % b for b in ssid)
+
+
+def fmt_err(code):
+    return code - (1 << 32) if code & 0x80000000 else code
+
+
+def fmt_health_probe(arg0, arg1):
+    rssi = fmt_err(arg1)
+    if arg0 == 0xFFFFFFFF:
+        return "lost rssi=%d" % rssi
+    return "rtt=%dms rssi=%d" % (arg0, rssi)
+
+
+RECOVER_ACTIONS = {1: "dhcp_renew", 2: "reconnect", 3: "retry"}
+
+
+def fmt_health_recover(arg0, arg1):
+    if arg0 == 3:
+        return "action=retry attempt=%d" % arg1
+    return "action=%s consecutive_lost=%d" % (RECOVER_ACTIONS.get(arg0, arg0), arg1)
+
+SCHED_REASONS = {0: "first", 1: "stable", 2: "hold", 3: "churn", 4: "disconnect"}
+
+STA_EVENTS = {
+    0x01: ("CONNECTED", fmt_connected),
+    0x02: ("GOT_IP", lambda a0, a1: "ip=%s gw=%s" % (ip4(a0), ip4(a1))),
+    0x03: ("NETMASK", lambda a0, a1: "netmask=%s" % ip4(a0)),
+    0x04: ("SCAN_NUM", lambda a0, a1: "ap_num=%d" % a0),
+    0x05: ("SCAN_AP", fmt_scan_ap),
+    0x06: ("RECONNECT", lambda a0, a1: "count=%d err=%d" % (a0, fmt_err(a1))),
+    0x07: ("HEALTH_PROBE", fmt_health_probe),
+    0x08: ("HEALTH_RECOVER", fmt_health_recover),
+    0x09: ("SCAN_SCHED", lambda a0, a1: "churn=%d reason=%s period=%dms" % (
+        a0 & 0xFF, SCHED_REASONS.get(a0 >> 8, a0 >> 8), a1)),
+    0x0A: ("AP_ID", lambda a0, a1: "bssid=%02x:%02x:.. ssid_len=%d ssid_hash=0x%08x" % (
+        a0 & 0xFF, (a0 >> 8) & 0xFF, (a0 >> 16) & 0xFF, a1)),
+    0x0B: ("AP_SSID", lambda a0, a1: "ssid_part=\"%s\"" % fmt_ssid(struct.pack("<II", a0, a1))),
+}
+
+# Events followed by AP_ID and AP_SSID records (wifi_sta_trace_write_ap)
+AP_EVENTS = (0x0301, 0x0305)
+AP_ID = 0x030A
+AP_SSID = 0x030B
+
+
+def pair_ap(records, i):
+    """Identity of the AP event records[i] from the records after it.
+
+    Returns (bssid, ssid, records consumed), or None if the follow-up records are missing.
+    """
+    if i + 1 >= len(records) or records[i + 1][3] != AP_ID:
+        return None
+    arg1 = records[i][5]
+    id_arg0, id_arg1 = records[i + 1][4], records[i + 1][5]
+    ssid_len = (id_arg0 >> 16) & 0xFF
+    chunks = (ssid_len + 7) // 8
+    parts = records[i + 2:i + 2 + chunks]
+    if len(parts) != chunks or any(r[3] != AP_SSID for r in parts):
+        return None
+    ssid = b"".join(struct.pack("<II", r[4], r[5]) for r in parts)[:ssid_len]
+    if ssid_hash(ssid) != id_arg1:
+        return None
+    bssid = ":".join("%02x" % b for b in struct.pack("<H", id_arg0 & 0xFFFF) + struct.pack("<I", arg1))
+    return bssid, ssid, 2 + chunks
+
+
+def describe(event_id, arg0, arg1):
+    source, ident = event_id >> 8, event_id & 0xFF
+    if source == SRC_WIFI:
+        name = WIFI_EVENTS[ident] if ident < len(WIFI_EVENTS) else "%d" % ident
+        return "WIFI_EVENT_" + name, ""
+    if source == SRC_IP:
+        name = IP_EVENTS[ident] if ident < len(IP_EVENTS) else "%d" % ident
+        return "IP_EVENT_" + name, ""
+    if source == SRC_STA and ident in STA_EVENTS:
+        name, fmt = STA_EVENTS[ident]
+        return "WIFI_STA_" + name, fmt(arg0, arg1)
+    return "0x%04x" % event_id, "arg0=0x%08x arg1=0x%08x" % (arg0, arg1)
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    # The text "WSTR" of a console log reads as the magic too, check the whole header
+    if len(data) >= HEADER.size and HEADER.unpack_from(data)[:3] == (MAGIC, VERSION, RECORD.size):
+        return data
+    # Console log: concatenate the hex payload of every WSTRACE line
+    chunks = []
+    for line in data.decode("utf-8", errors="replace").splitlines():
+        pos = line.find("WSTRACE ")
+        if pos >= 0:
+            chunks.append(bytes.fromhex(line[pos + len("WSTRACE "):].strip()))
+    return b"".join(chunks)
+
+
+def decode(data, out):
+    if len(data) < HEADER.size:
+        raise ValueError("no trace header found")
+    magic, version, record_size, count, dropped = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION or record_size != RECORD.size:
+        raise ValueError("unsupported dump (magic 0x%08x, version %d, record size %d)"
+                         % (magic, version, record_size))
+    available = (len(data) - HEADER.size) // RECORD.size
+    if available < count:
+        out.write("warning: dump truncated, %d of %d records\n" % (available, count))
+        count = available
+    out.write("%d records, %d dropped\n" % (count, dropped))
+
+    records = [RECORD.unpack_from(data, HEADER.size + i * RECORD.size) for i in range(count)]
+    base = None
+    previous = 0
+    absolute = 0
+    i = 0
+    while i < count:
+        ts, core, level, event_id, arg0, arg1 = records[i]
+        # Timestamps are the low 32 bits of esp_timer, unwrap them. Records from two cores
+        # may be a little out of order: only a step of more than 2^31 backward is a wrap.
+        if base is None:
+            absolute = base = ts
+        else:
+            step = (ts - previous) & 0xFFFFFFFF
+            if step >= 1 << 31:
+                step -= 1 << 32
+            absolute += step
+        previous = ts
+        name, details = describe(event_id, arg0, arg1)
+        consumed = 1
+        paired = pair_ap(records, i) if event_id in AP_EVENTS else None
+        if paired is not None:
+            bssid, ssid, consumed = paired
+            details = "%s bssid=%s ssid=\"%s\"" % (details[:details.index(" bssid=")], bssid, fmt_ssid(ssid))
+        out.write("%12.6f  +%10.6f  core%d  %s  %-28s %s\n" % (
+            absolute / 1e6, (absolute - base) / 1e6, core, LEVELS.get(level, "?"), name, details))
+        i += consumed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", help="console log or binary partition image")
+    args = parser.parse_args()
+    try:
+        decode(load(args.dump), sys.stdout)
+    except ValueError as err:
+        sys.exit("error: %s" % err)
+
+
+if __name__ == "__main__":
+    main()
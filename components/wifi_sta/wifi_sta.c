@@ -1,4 +1,7 @@
 #include "wifi_sta.h"
+#include "wifi_sta_trace.h"
+#include "wifi_sta_scan_sched.h"
+#include "wifi_sta_profile.h"
 #include "esp_err.h"
 #include "esp_private/wifi.h"
 #include "freertos/event_groups.h"
@@ -13,6 +16,7 @@ static const char* TAG = "WIFI_STA";
 static esp_netif_t *s_wifi_netif = NULL;
 static wifi_netif_driver_t *s_wifi_netif_driver = NULL;
 static uint8_t reconnect_count = 0;
+static esp_ip4_addr_t s_gateway = { 0 };
 
 /******************************
  * Private functions prototypes
@@ -62,6 +66,7 @@ static void on_wifi_event   (void* arg,
                             int32_t event_id,
                             void* event_data)
 {
+    WIFI_STA_TRACE_I (WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_WIFI, event_id), 0, 0);
     switch (event_id){
         case WIFI_EVENT_STA_START:  // Wifi start
             if (s_wifi_netif != NULL){
@@ -88,7 +93,7 @@ static void on_wifi_event   (void* arg,
             wifi_scan_done_cb();
             break;
         default:
-            ESP_LOGI(TAG, "Unexpected behavior %" PRId32 " in WiFi event", event_id);
+            // Already traced above
             break;
     }
 }
@@ -98,21 +103,25 @@ void on_ip_event    (void *arg,
                      int32_t event_id,
                      void* event_data)
 {
+    WIFI_STA_TRACE_I (WIFI_STA_TRACE_ID(WIFI_STA_TRACE_SRC_IP, event_id), 0, 0);
     switch (event_id){
         case IP_EVENT_STA_GOT_IP: // DHCP clients successfully get IP address
             ip_event_got_ip_t* event_got_ip = (ip_event_got_ip_t*) event_data;
             esp_netif_ip_info_t *ip_info = &event_got_ip->ip_info;
-            ESP_LOGI (TAG, "Wifi IP adress obtained");
-            ESP_LOGI (TAG, "IP address: " IPSTR, IP2STR(&ip_info->ip));
-            ESP_LOGI (TAG, "Net mask: " IPSTR, IP2STR(&ip_info->netmask));
-            ESP_LOGI (TAG, "Gateway IP: " IPSTR, IP2STR(&ip_info->gw));
+            WIFI_STA_TRACE_I (WIFI_STA_TRACE_GOT_IP, ip_info->ip.addr, ip_info->gw.addr);
+            WIFI_STA_TRACE_V (WIFI_STA_TRACE_NETMASK, ip_info->netmask.addr, 0);
+            s_gateway = ip_info->gw;
+            // Link is back: the next drop gets the full reconnect budget again
+            reconnect_count = 0;
+            xEventGroupClearBits (e_wifi_event_group, WIFI_STA_HEALTH_RECOVER);
             xEventGroupSetBits (e_wifi_event_group, WIFI_STA_IPV4_OBTAINED_BIT);
             break;
         case IP_EVENT_STA_LOST_IP:
-            ESP_LOGI (TAG, "Wifi lost IP address");
+            s_gateway.addr = 0;
+            xEventGroupClearBits (e_wifi_event_group, WIFI_STA_IPV4_OBTAINED_BIT);
             break;
         default:
-            ESP_LOGI(TAG, "Unexpected behavior %" PRId32 " in IP event", event_id);
+            // Already traced above
             break;
     }
 }
@@ -199,11 +208,9 @@ static void wifi_connected_cb   (void* esp_netif,
                                 void* event_data)
 {
     wifi_event_sta_connected_t *event_sta_connected = (wifi_event_sta_connected_t*) event_data;
-    ESP_LOGI (TAG, "Connected to AP");
-    ESP_LOGI (TAG, "SSID: %s", (char*) event_sta_connected->ssid);
-    ESP_LOGI (TAG, "Channel: %d", event_sta_connected->channel);
-    ESP_LOGI (TAG, "Auth mode: %d", event_sta_connected->authmode);
-    ESP_LOGI (TAG, "AID: %d", event_sta_connected->aid);
+    WIFI_STA_TRACE_AP_I (WIFI_STA_TRACE_CONNECTED,
+                         event_sta_connected->channel | (event_sta_connected->authmode << 8) | (event_sta_connected->aid << 16),
+                         event_sta_connected->bssid, event_sta_connected->ssid);
 
     // Register interface receive callback
     wifi_netif_driver_t driver = esp_netif_get_io_driver(s_wifi_netif);
@@ -229,14 +236,35 @@ static void wifi_connected_cb   (void* esp_netif,
 
 static void wifi_disconnected_cb(){
     EventBits_t chosen = xEventGroupGetBits (e_wifi_event_group);
+    xEventGroupClearBits (e_wifi_event_group, WIFI_STA_CONNECTED_BIT | WIFI_STA_IPV4_OBTAINED_BIT);
+    s_gateway.addr = 0;
+    if ((chosen & WIFI_STA_CONNECTED_BIT) && !(chosen & (WIFI_STA_STOP | WIFI_STA_DISCONNECT))){
+        // Link lost, surroundings may have changed: rescan soon
+        wifi_sta_scan_sched_notify_disconnect();
+    }
     if (chosen & WIFI_STA_STOP){
-        // User call stop function                
+        // User call stop function, a pending health recovery is dropped
+        xEventGroupClearBits (e_wifi_event_group, WIFI_STA_HEALTH_RECOVER);
         ESP_LOGI (TAG, "Diconnect is caused by stop function");
     }
     else if (chosen & WIFI_STA_DISCONNECT){
-        // User call disconnect function                
+        // User call disconnect function, a pending health recovery is dropped
+        xEventGroupClearBits (e_wifi_event_group, WIFI_STA_HEALTH_RECOVER);
         ESP_LOGI (TAG, "Disconnect successfully from %s", CONFIG_WIFI_STA_SSID);
     }
+    else if (chosen & WIFI_STA_HEALTH_RECOVER){
+        // Recovery lasts until IP_EVENT_STA_GOT_IP
+        if (chosen & WIFI_STA_CONNECTED_BIT){
+            // Disconnect is requested by the link health monitor
+            ESP_LOGW (TAG, "Link unhealthy, reconnect to %s", CONFIG_WIFI_STA_SSID);
+            reconnect_count = 0;
+            reconnect_wifi();
+        }
+        else {
+            // Failed attempt, the link health monitor retries with backoff
+            ESP_LOGW (TAG, "Reconnect to %s failed, retry later", CONFIG_WIFI_STA_SSID);
+        }
+    }
     else{
         // Connect failed from esp_connect function
         ESP_LOGE (TAG, "Connect failed to %s", CONFIG_WIFI_STA_SSID);
@@ -264,7 +292,7 @@ static void reconnect_wifi(){
     if (esp_ret != ESP_OK){
         ESP_LOGE (TAG, "Failled to reconnect to %s",CONFIG_WIFI_STA_SSID);
     }
-    ESP_LOGI (TAG, "Reconnect to %s: %d",CONFIG_WIFI_STA_SSID,reconnect_count);
+    WIFI_STA_TRACE_I (WIFI_STA_TRACE_RECONNECT, reconnect_count, esp_ret);
     reconnect_count++;
 }
  
@@ -317,19 +345,19 @@ esp_err_t wifi_sta_init (EventGroupHandle_t event_group){
         return ESP_FAIL;
     }
 
-    // // Register IP event                                          
-    // esp_ret = esp_event_handler_register (IP_EVENT,
-    //                                       ESP_EVENT_ANY_ID,
-    //                                       &on_ip_event,
-    //                                       NULL);
-    
-    // if (esp_ret != ESP_OK) {
-    //     ESP_LOGE(TAG, "Failed to register IP event handler");
-    //     return ESP_FAIL;
-    // }
+    // Register IP event (gateway is needed by the link health monitor)
+    esp_ret = esp_event_handler_register (IP_EVENT,
+                                          ESP_EVENT_ANY_ID,
+                                          &on_ip_event,
+                                          NULL);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register IP event handler");
+        return ESP_FAIL;
+    }
     
-    // Initialize Wifi
+    // Initialize Wifi with the buffer and AMPDU settings of the profile (wifi_sta_profile.h)
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    wifi_sta_profile_apply (&cfg);
     esp_ret = esp_wifi_init (&cfg);
     if (esp_ret != ESP_OK){
         ESP_LOGE (TAG, "Failed to initialize WiFi");
@@ -363,6 +391,11 @@ esp_err_t wifi_sta_init (EventGroupHandle_t event_group){
         ESP_LOGE (TAG, "Failed to start the WiFi driver");
         return ESP_FAIL;
     }
+    esp_ret = wifi_sta_profile_finish();
+    if (esp_ret != ESP_OK){
+        ESP_LOGE (TAG, "Failed to apply the WiFi profile");
+        return ESP_FAIL;
+    }
     return ESP_OK;
 }    
 
@@ -371,3 +404,19 @@ esp_err_t wifi_sta_stop (void){
     return esp_wifi_stop();
 }
 
+esp_netif_t *wifi_sta_get_netif (void){
+    return s_wifi_netif;
+}
+
+esp_err_t wifi_sta_get_gateway (esp_ip4_addr_t *gateway){
+    if (gateway == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    EventBits_t uxBit = xEventGroupGetBits (e_wifi_event_group);
+    if (!(uxBit & WIFI_STA_IPV4_OBTAINED_BIT) || s_gateway.addr == 0){
+        return ESP_ERR_INVALID_STATE;
+    }
+    *gateway = s_gateway;
+    return ESP_OK;
+}
+
@@ -0,0 +1,419 @@
+#include "wifi_sta.h"
+#include "wifi_sta_health.h"
+#include "wifi_sta_trace.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "lwip/sockets.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/icmp.h"
+#include "lwip/ip.h"
+#include <inttypes.h>
+#include <string.h>
+// Tag for debug messages
+static const char* TAG = "WIFI_STA_HEALTH";
+
+// Recovery actions (trace payload)
+#define HEALTH_ACTION_DHCP_RENEW    1
+#define HEALTH_ACTION_RECONNECT     2
+#define HEALTH_ACTION_RETRY         3
+
+// First reconnect retry after this many minimum intervals, time for association and DHCP
+#define HEALTH_RETRY_FIRST_INTERVALS    4
+
+// Echo identifier of our probes
+#define HEALTH_ICMP_ID              0x5753
+
+// Averages are kept in fixed point (value << 3) so they settle on the input, weight 1/8 per probe
+#define HEALTH_EWMA_SHIFT           3
+
+// Static global variables
+static TaskHandle_t s_health_task = NULL;
+static volatile bool s_health_running = false;
+static volatile bool s_health_activity = false;
+static int s_health_sock = -1;
+static uint16_t s_health_seq = 0;
+static uint32_t s_loss_window = 0;     // Bit set per lost probe, newest in bit 0
+static uint8_t s_renew_wait = 0;       // Intervals spent without IP since the DHCP renewal
+static int64_t s_retry_at_us = 0;      // Next reconnect attempt while recovering
+static uint32_t s_retry_delay_ms = 0;
+static uint32_t s_retry_count = 0;
+static wifi_sta_health_stats_t s_stats;
+static int32_t s_rssi_avg_fp = 0;
+static int32_t s_rtt_avg_fp = 0;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************
+ * Private functions prototypes
+ */
+
+static void health_task (void *arg);
+
+static esp_err_t health_icmp_echo (esp_ip4_addr_t gateway, uint16_t seq, uint32_t *rtt_ms);
+
+static void health_probe (void);
+
+static inline int32_t health_ewma_round (int32_t avg_fp);
+
+static inline void health_ewma_update (int32_t *avg_fp, int32_t value);
+
+static void health_recover (uint8_t action, uint8_t consecutive_lost);
+
+static void health_retry (EventBits_t bits);
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+/**
+ * @brief Send one ICMP echo request to the gateway and wait for the reply
+ *
+ * @return
+ * - ESP_OK : Reply received, rtt_ms is set
+ * - ESP_ERR_TIMEOUT : No reply before CONFIG_WIFI_STA_HEALTH_PROBE_TIMEOUT_MS
+ * - ESP_FAIL : Request could not be sent
+ */
+static esp_err_t health_icmp_echo (esp_ip4_addr_t gateway, uint16_t seq, uint32_t *rtt_ms)
+{
+    if (s_health_sock < 0){
+        s_health_sock = socket (AF_INET, SOCK_RAW, IP_PROTO_ICMP);
+        if (s_health_sock < 0){
+            ESP_LOGE (TAG, "Failed to create ICMP socket");
+            return ESP_FAIL;
+        }
+    }
+
+    struct icmp_echo_hdr request = { 0 };
+    ICMPH_TYPE_SET (&request, ICMP_ECHO);
+    ICMPH_CODE_SET (&request, 0);
+    request.id = lwip_htons (HEALTH_ICMP_ID);
+    request.seqno = lwip_htons (seq);
+    request.chksum = inet_chksum (&request, sizeof(request));
+
+    struct sockaddr_in target = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = gateway.addr,
+    };
+    int64_t start_us = esp_timer_get_time();
+    if (sendto (s_health_sock, &request, sizeof(request), 0, (struct sockaddr*)&target, sizeof(target)) < 0){
+        // Recreate the socket on the next probe
+        close (s_health_sock);
+        s_health_sock = -1;
+        return ESP_FAIL;
+    }
+
+    // Raw ICMP sockets see every echo reply, skip the ones that are not ours
+    while (1){
+        int64_t remaining_ms = CONFIG_WIFI_STA_HEALTH_PROBE_TIMEOUT_MS - (esp_timer_get_time() - start_us) / 1000;
+        if (remaining_ms <= 0){
+            return ESP_ERR_TIMEOUT;
+        }
+        struct timeval timeout = {
+            .tv_sec = remaining_ms / 1000,
+            .tv_usec = (remaining_ms % 1000) * 1000,
+        };
+        setsockopt (s_health_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        uint8_t reply[64];
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        int len = recvfrom (s_health_sock, reply, sizeof(reply), 0, (struct sockaddr*)&from, &from_len);
+        if (len < 0){
+            return ESP_ERR_TIMEOUT;
+        }
+        if (len < (int) sizeof(struct ip_hdr) || from.sin_addr.s_addr != gateway.addr){
+            continue;
+        }
+        struct ip_hdr *ip_header = (struct ip_hdr*) reply;
+        int header_len = IPH_HL (ip_header) * 4;
+        if (len < header_len + (int) sizeof(struct icmp_echo_hdr)){
+            continue;
+        }
+        struct icmp_echo_hdr *echo = (struct icmp_echo_hdr*) (reply + header_len);
+        if (ICMPH_TYPE (echo) == ICMP_ER &&
+            echo->id == request.id &&
+            echo->seqno == request.seqno){
+            *rtt_ms = (uint32_t) ((esp_timer_get_time() - start_us) / 1000);
+            return ESP_OK;
+        }
+    }
+}
+
+/**
+ * @brief Renew the DHCP lease or force a reconnect
+ */
+static void health_recover (uint8_t action, uint8_t consecutive_lost)
+{
+    if (action == HEALTH_ACTION_DHCP_RENEW){
+        ESP_LOGW (TAG, "Gateway not answering, renew DHCP lease");
+        WIFI_STA_TRACE_I (WIFI_STA_TRACE_HEALTH_RECOVER, HEALTH_ACTION_DHCP_RENEW, consecutive_lost);
+        esp_netif_t *netif = wifi_sta_get_netif();
+        esp_netif_dhcpc_stop (netif);
+        if (esp_netif_dhcpc_start (netif) != ESP_OK){
+            ESP_LOGE (TAG, "Failed to restart DHCP client");
+        }
+        s_renew_wait = 1;
+        portENTER_CRITICAL (&s_stats_lock);
+        s_stats.dhcp_renewals++;
+        portEXIT_CRITICAL (&s_stats_lock);
+    }
+    else {
+        ESP_LOGW (TAG, "Gateway not answering, reconnect");
+        WIFI_STA_TRACE_I (WIFI_STA_TRACE_HEALTH_RECOVER, HEALTH_ACTION_RECONNECT, consecutive_lost);
+        // wifi_disconnected_cb reconnects when it sees WIFI_STA_HEALTH_RECOVER,
+        // health_retry keeps trying until IP_EVENT_STA_GOT_IP clears it
+        s_renew_wait = 0;
+        s_retry_count = 0;
+        s_retry_delay_ms = CONFIG_WIFI_STA_HEALTH_INTERVAL_MIN_MS * HEALTH_RETRY_FIRST_INTERVALS;
+        s_retry_at_us = esp_timer_get_time() + (int64_t) s_retry_delay_ms * 1000;
+        xEventGroupSetBits (e_wifi_event_group, WIFI_STA_HEALTH_RECOVER);
+        if (esp_wifi_disconnect() != ESP_OK){
+            ESP_LOGE (TAG, "Failed to disconnect");
+            xEventGroupClearBits (e_wifi_event_group, WIFI_STA_HEALTH_RECOVER);
+            return;
+        }
+        portENTER_CRITICAL (&s_stats_lock);
+        s_stats.reconnects++;
+        s_stats.consecutive_lost = 0;
+        portEXIT_CRITICAL (&s_stats_lock);
+    }
+}
+
+/**
+ * @brief Reconnect again while recovering without an address, backing off up to the maximum interval
+ * A station that associated but got no address is disconnected, wifi_disconnected_cb reconnects it.
+ */
+static void health_retry (EventBits_t bits)
+{
+    int64_t now_us = esp_timer_get_time();
+    if (now_us < s_retry_at_us){
+        return;
+    }
+    s_retry_count++;
+    ESP_LOGW (TAG, "No address since the reconnect, retry %" PRIu32, s_retry_count);
+    WIFI_STA_TRACE_I (WIFI_STA_TRACE_HEALTH_RECOVER, HEALTH_ACTION_RETRY, s_retry_count);
+    esp_err_t esp_ret = (bits & WIFI_STA_CONNECTED_BIT) ? esp_wifi_disconnect() : esp_wifi_connect();
+    if (esp_ret != ESP_OK){
+        ESP_LOGE (TAG, "ERROR (%d): Failed to retry the reconnect", esp_ret);
+    }
+    s_retry_delay_ms *= 2;
+    if (s_retry_delay_ms > CONFIG_WIFI_STA_HEALTH_INTERVAL_MAX_MS){
+        s_retry_delay_ms = CONFIG_WIFI_STA_HEALTH_INTERVAL_MAX_MS;
+    }
+    s_retry_at_us = now_us + (int64_t) s_retry_delay_ms * 1000;
+}
+
+/**
+ * @brief Fixed point average rounded to the nearest integer (arithmetic shift)
+ */
+static inline int32_t health_ewma_round (int32_t avg_fp)
+{
+    return (avg_fp + (1 << (HEALTH_EWMA_SHIFT - 1))) >> HEALTH_EWMA_SHIFT;
+}
+
+static inline void health_ewma_update (int32_t *avg_fp, int32_t value)
+{
+    *avg_fp += value - health_ewma_round (*avg_fp);
+}
+
+/**
+ * @brief Measure RSSI and gateway RTT, update statistics and the next interval
+ */
+static void health_probe (void)
+{
+    esp_ip4_addr_t gateway;
+    if (wifi_sta_get_gateway (&gateway) != ESP_OK){
+        return;
+    }
+    wifi_ap_record_t ap_info;
+    int8_t rssi = s_stats.rssi;
+    if (esp_wifi_sta_get_ap_info (&ap_info) == ESP_OK){
+        rssi = ap_info.rssi;
+    }
+    uint32_t rtt_ms = 0;
+    esp_err_t esp_ret = health_icmp_echo (gateway, s_health_seq++, &rtt_ms);
+    bool lost = (esp_ret != ESP_OK);
+    WIFI_STA_TRACE_V (WIFI_STA_TRACE_HEALTH_PROBE, lost ? UINT32_MAX : rtt_ms, rssi);
+
+    s_loss_window = (s_loss_window << 1) | (lost ? 1 : 0);
+
+    portENTER_CRITICAL (&s_stats_lock);
+    uint32_t window = s_stats.probes_sent < 32 ? s_stats.probes_sent + 1 : 32;
+    uint32_t mask = window < 32 ? ((1UL << window) - 1) : UINT32_MAX;
+    if (s_stats.probes_sent == 0){
+        s_rssi_avg_fp = rssi * (1 << HEALTH_EWMA_SHIFT);
+    }
+    s_stats.probes_sent++;
+    s_stats.rssi = rssi;
+    health_ewma_update (&s_rssi_avg_fp, rssi);
+    s_stats.rssi_avg = (int8_t) health_ewma_round (s_rssi_avg_fp);
+    s_stats.loss_percent = (uint8_t) (__builtin_popcount (s_loss_window & mask) * 100 / window);
+    if (lost){
+        s_stats.probes_lost++;
+        if (esp_ret == ESP_FAIL){
+            s_stats.tx_failures++;
+        }
+        if (s_stats.consecutive_lost < UINT8_MAX){
+            s_stats.consecutive_lost++;
+        }
+    }
+    else {
+        if (s_stats.probes_sent - s_stats.probes_lost == 1){
+            // First reply
+            s_rtt_avg_fp = (int32_t) rtt_ms << HEALTH_EWMA_SHIFT;
+        }
+        health_ewma_update (&s_rtt_avg_fp, (int32_t) rtt_ms);
+        s_stats.rtt_avg_ms = (uint32_t) health_ewma_round (s_rtt_avg_fp);
+        s_stats.rtt_last_ms = rtt_ms;
+        s_stats.consecutive_lost = 0;
+        s_renew_wait = 0;
+    }
+    s_stats.healthy = !lost &&
+                      rtt_ms <= CONFIG_WIFI_STA_HEALTH_RTT_DEGRADED_MS &&
+                      rssi >= CONFIG_WIFI_STA_HEALTH_RSSI_DEGRADED;
+    // Back off while healthy and idle, probe fast otherwise
+    if (s_stats.healthy && !s_health_activity){
+        s_stats.interval_ms *= 2;
+        if (s_stats.interval_ms > CONFIG_WIFI_STA_HEALTH_INTERVAL_MAX_MS){
+            s_stats.interval_ms = CONFIG_WIFI_STA_HEALTH_INTERVAL_MAX_MS;
+        }
+    }
+    else {
+        s_stats.interval_ms = CONFIG_WIFI_STA_HEALTH_INTERVAL_MIN_MS;
+    }
+    s_health_activity = false;
+    uint8_t consecutive_lost = s_stats.consecutive_lost;
+    portEXIT_CRITICAL (&s_stats_lock);
+
+    // Renew DHCP first, reconnect if the gateway still does not answer
+    if (consecutive_lost >= CONFIG_WIFI_STA_HEALTH_RECONNECT_AFTER){
+        health_recover (HEALTH_ACTION_RECONNECT, consecutive_lost);
+    }
+    else if (consecutive_lost == CONFIG_WIFI_STA_HEALTH_RENEW_AFTER){
+        health_recover (HEALTH_ACTION_DHCP_RENEW, consecutive_lost);
+    }
+}
+
+static void health_task (void *arg)
+{
+    int64_t last_probe_us = esp_timer_get_time();
+    while (s_health_running){
+        EventBits_t uxBit = xEventGroupGetBits (e_wifi_event_group);
+        if (!(uxBit & WIFI_STA_IPV4_OBTAINED_BIT)){
+            // Nothing to probe until DHCP gives us a gateway
+            portENTER_CRITICAL (&s_stats_lock);
+            s_stats.healthy = false;
+            s_stats.consecutive_lost = 0;
+            s_stats.interval_ms = CONFIG_WIFI_STA_HEALTH_INTERVAL_MIN_MS;
+            portEXIT_CRITICAL (&s_stats_lock);
+            // Woken early by an address or by stop
+            xEventGroupWaitBits (e_wifi_event_group,
+                                 WIFI_STA_IPV4_OBTAINED_BIT | WIFI_STA_HEALTH_WAKE,
+                                 pdFALSE,
+                                 pdFALSE,
+                                 pdMS_TO_TICKS(CONFIG_WIFI_STA_HEALTH_INTERVAL_MIN_MS));
+            uxBit = xEventGroupClearBits (e_wifi_event_group, WIFI_STA_HEALTH_WAKE);
+            last_probe_us = esp_timer_get_time();
+            if (!s_health_running || (uxBit & WIFI_STA_IPV4_OBTAINED_BIT)){
+                continue;
+            }
+            if (uxBit & WIFI_STA_HEALTH_RECOVER){
+                health_retry (uxBit);
+            }
+            else if (s_renew_wait != 0 && (uxBit & WIFI_STA_CONNECTED_BIT) &&
+                     ++s_renew_wait > CONFIG_WIFI_STA_HEALTH_RECONNECT_AFTER){
+                // DHCP renewal did not bring the address back: reconnect
+                health_recover (HEALTH_ACTION_RECONNECT, s_renew_wait);
+            }
+            continue;
+        }
+        if (s_health_activity && s_stats.interval_ms > CONFIG_WIFI_STA_HEALTH_INTERVAL_MIN_MS){
+            portENTER_CRITICAL (&s_stats_lock);
+            s_stats.interval_ms = CONFIG_WIFI_STA_HEALTH_INTERVAL_MIN_MS;
+            portEXIT_CRITICAL (&s_stats_lock);
+        }
+        int64_t wait_ms = s_stats.interval_ms - (esp_timer_get_time() - last_probe_us) / 1000;
+        if (wait_ms > 0){
+            // Woken early by stop or activity notifications
+            ulTaskNotifyTake (pdTRUE, pdMS_TO_TICKS(wait_ms));
+            continue;
+        }
+        last_probe_us = esp_timer_get_time();
+        health_probe ();
+    }
+    if (s_health_sock >= 0){
+        close (s_health_sock);
+        s_health_sock = -1;
+    }
+    s_health_task = NULL;
+    vTaskDelete (NULL);
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+esp_err_t wifi_sta_health_start(void)
+{
+    if (s_health_task != NULL){
+        ESP_LOGE (TAG, "Link health monitor is already started");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (e_wifi_event_group == NULL || wifi_sta_get_netif() == NULL){
+        ESP_LOGE (TAG, "WiFi is not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    memset (&s_stats, 0, sizeof(s_stats));
+    s_rssi_avg_fp = 0;
+    s_rtt_avg_fp = 0;
+    s_stats.interval_ms = CONFIG_WIFI_STA_HEALTH_INTERVAL_MIN_MS;
+    s_loss_window = 0;
+    s_renew_wait = 0;
+    s_health_running = true;
+    xEventGroupClearBits (e_wifi_event_group, WIFI_STA_HEALTH_WAKE);
+    if (xTaskCreate (health_task, "wifi_health", CONFIG_WIFI_STA_HEALTH_TASK_STACK_SIZE,
+                     NULL, CONFIG_WIFI_STA_HEALTH_TASK_PRIORITY, &s_health_task) != pdPASS){
+        ESP_LOGE (TAG, "Failed to create link health task");
+        s_health_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t wifi_sta_health_stop(void)
+{
+    if (s_health_task == NULL || !s_health_running){
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_health_running = false;
+    // Nobody retries a pending recovery once the monitor is gone
+    xEventGroupClearBits (e_wifi_event_group, WIFI_STA_HEALTH_RECOVER);
+    // The task waits on a notification while probing, on the event group without an address
+    xTaskNotifyGive (s_health_task);
+    xEventGroupSetBits (e_wifi_event_group, WIFI_STA_HEALTH_WAKE);
+    return ESP_OK;
+}
+
+esp_err_t wifi_sta_health_get_stats(wifi_sta_health_stats_t *stats)
+{
+    if (stats == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL (&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL (&s_stats_lock);
+    stats->running = (s_health_task != NULL && s_health_running);
+    return ESP_OK;
+}
+
+void wifi_sta_health_notify_activity(void)
+{
+    s_health_activity = true;
+    if (s_health_task != NULL && s_stats.interval_ms > CONFIG_WIFI_STA_HEALTH_INTERVAL_MIN_MS){
+        xTaskNotifyGive (s_health_task);
+    }
+}
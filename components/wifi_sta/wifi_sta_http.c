@@ -0,0 +1,274 @@
+#include "wifi_sta.h"
+#include "wifi_sta_http.h"
+#include "wifi_sta_json.h"
+#include "wifi_sta_health.h"
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+// Tag for debug messages
+static const char* TAG = "WIFI_STA_HTTP";
+
+/**
+ * @brief Published scan results
+ * Freed by whoever drops the last reference: the next wifi_sta_http_set_scan()
+ * or the last response still streaming them.
+ */
+typedef struct {
+    wifi_ap_record_t *ap_record;
+    uint16_t ap_num;
+    uint16_t refs;
+} http_scan_t;
+
+// Static global variables
+static httpd_handle_t s_server = NULL;
+static http_scan_t *s_scan = NULL;
+// Only guards s_scan, s_scan_enabled and the reference counts, never held while sending
+static portMUX_TYPE s_scan_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_scan_enabled = false;
+
+/******************************
+ * Private functions prototypes
+ */
+
+static esp_err_t http_send_chunk (void *req, const char *data, size_t len);
+
+static esp_err_t http_finish (httpd_req_t *req, wifi_sta_json_t *json);
+
+static void http_json_ip4 (wifi_sta_json_t *json, const char *key, const esp_ip4_addr_t *addr);
+
+static http_scan_t *http_scan_acquire (void);
+
+static void http_scan_release (http_scan_t *scan);
+
+static esp_err_t http_scan_handler (httpd_req_t *req);
+
+static esp_err_t http_status_handler (httpd_req_t *req);
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+/**
+ * @brief JSON encoder output: one HTTP chunk per full buffer
+ */
+static esp_err_t http_send_chunk (void *req, const char *data, size_t len)
+{
+    return httpd_resp_send_chunk ((httpd_req_t*) req, data, len);
+}
+
+/**
+ * @brief Flush the encoder and terminate the chunked response
+ */
+static esp_err_t http_finish (httpd_req_t *req, wifi_sta_json_t *json)
+{
+    esp_err_t esp_ret = wifi_sta_json_finish (json);
+    if (esp_ret != ESP_OK){
+        ESP_LOGE (TAG, "Failed to send response (%d)", esp_ret);
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk (req, NULL, 0);
+}
+
+static void http_json_ip4 (wifi_sta_json_t *json, const char *key, const esp_ip4_addr_t *addr)
+{
+    char ip_str[16];
+    esp_ip4addr_ntoa (addr, ip_str, sizeof(ip_str));
+    wifi_sta_json_string (json, key, ip_str, sizeof(ip_str));
+}
+
+/**
+ * @brief Take a reference on the published scan results (NULL if none)
+ */
+static http_scan_t *http_scan_acquire (void)
+{
+    portENTER_CRITICAL (&s_scan_lock);
+    http_scan_t *scan = s_scan;
+    if (scan != NULL){
+        scan->refs++;
+    }
+    portEXIT_CRITICAL (&s_scan_lock);
+    return scan;
+}
+
+static void http_scan_release (http_scan_t *scan)
+{
+    if (scan == NULL){
+        return;
+    }
+    portENTER_CRITICAL (&s_scan_lock);
+    bool last = (--scan->refs == 0);
+    portEXIT_CRITICAL (&s_scan_lock);
+    if (last){
+        free (scan->ap_record);
+        free (scan);
+    }
+}
+
+static esp_err_t http_scan_handler (httpd_req_t *req)
+{
+    char buf[CONFIG_WIFI_STA_HTTP_CHUNK_SIZE];
+    wifi_sta_json_t json;
+    httpd_resp_set_type (req, "application/json");
+    wifi_sta_json_init (&json, buf, sizeof(buf), http_send_chunk, req);
+
+    // Records are read in place, the reference keeps them alive while a slow client
+    // is served and a new publication does not wait for it
+    http_scan_t *scan = http_scan_acquire();
+    uint16_t ap_num = (scan != NULL) ? scan->ap_num : 0;
+    wifi_sta_json_object_begin (&json, NULL);
+    wifi_sta_json_int (&json, "ap_num", ap_num);
+    wifi_sta_json_array_begin (&json, "aps");
+    for (uint16_t i = 0; i < ap_num && json.err == ESP_OK; i++){
+        wifi_sta_json_ap_record (&json, NULL, &scan->ap_record[i]);
+    }
+    wifi_sta_json_array_end (&json);
+    wifi_sta_json_object_end (&json);
+    esp_err_t esp_ret = http_finish (req, &json);
+    http_scan_release (scan);
+    return esp_ret;
+}
+
+static esp_err_t http_status_handler (httpd_req_t *req)
+{
+    char buf[CONFIG_WIFI_STA_HTTP_CHUNK_SIZE];
+    wifi_sta_json_t json;
+    httpd_resp_set_type (req, "application/json");
+    wifi_sta_json_init (&json, buf, sizeof(buf), http_send_chunk, req);
+
+    EventBits_t uxBit = xEventGroupGetBits (e_wifi_event_group);
+    wifi_sta_json_object_begin (&json, NULL);
+    wifi_sta_json_bool (&json, "connected", uxBit & WIFI_STA_CONNECTED_BIT);
+    wifi_sta_json_bool (&json, "ipv4", uxBit & WIFI_STA_IPV4_OBTAINED_BIT);
+
+    esp_netif_ip_info_t ip_info;
+    if ((uxBit & WIFI_STA_IPV4_OBTAINED_BIT) &&
+        esp_netif_get_ip_info (wifi_sta_get_netif(), &ip_info) == ESP_OK){
+        http_json_ip4 (&json, "ip", &ip_info.ip);
+        http_json_ip4 (&json, "netmask", &ip_info.netmask);
+        http_json_ip4 (&json, "gateway", &ip_info.gw);
+    }
+
+    wifi_ap_record_t ap_info;
+    if ((uxBit & WIFI_STA_CONNECTED_BIT) && esp_wifi_sta_get_ap_info (&ap_info) == ESP_OK){
+        wifi_sta_json_ap_record (&json, "ap", &ap_info);
+    }
+
+    wifi_sta_health_stats_t health;
+    wifi_sta_health_get_stats (&health);
+    wifi_sta_json_object_begin (&json, "health");
+    wifi_sta_json_bool (&json, "running", health.running);
+    // Statistics of a monitor that never ran are not measurements
+    if (health.running){
+        wifi_sta_json_bool (&json, "healthy", health.healthy);
+        wifi_sta_json_int (&json, "rssi", health.rssi);
+        wifi_sta_json_int (&json, "rssi_avg", health.rssi_avg);
+        wifi_sta_json_int (&json, "rtt_last_ms", health.rtt_last_ms);
+        wifi_sta_json_int (&json, "rtt_avg_ms", health.rtt_avg_ms);
+        wifi_sta_json_int (&json, "probes_sent", health.probes_sent);
+        wifi_sta_json_int (&json, "probes_lost", health.probes_lost);
+        wifi_sta_json_int (&json, "tx_failures", health.tx_failures);
+        wifi_sta_json_int (&json, "loss_percent", health.loss_percent);
+        wifi_sta_json_int (&json, "dhcp_renewals", health.dhcp_renewals);
+        wifi_sta_json_int (&json, "reconnects", health.reconnects);
+        wifi_sta_json_int (&json, "interval_ms", health.interval_ms);
+    }
+    wifi_sta_json_object_end (&json);
+
+    http_scan_t *scan = http_scan_acquire();
+    wifi_sta_json_int (&json, "scan_ap_num", (scan != NULL) ? scan->ap_num : 0);
+    http_scan_release (scan);
+    wifi_sta_json_object_end (&json);
+    return http_finish (req, &json);
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+esp_err_t wifi_sta_http_start(void)
+{
+    if (s_server != NULL){
+        ESP_LOGE (TAG, "HTTP server is already started");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = CONFIG_WIFI_STA_HTTP_PORT;
+    // Handlers put the JSON chunk buffer on the server task stack
+    config.stack_size += CONFIG_WIFI_STA_HTTP_CHUNK_SIZE;
+    esp_err_t esp_ret = httpd_start (&s_server, &config);
+    if (esp_ret != ESP_OK){
+        ESP_LOGE (TAG, "Failed to start HTTP server");
+        s_server = NULL;
+        return esp_ret;
+    }
+
+    const httpd_uri_t scan_uri = {
+        .uri = "/scan",
+        .method = HTTP_GET,
+        .handler = http_scan_handler,
+    };
+    const httpd_uri_t status_uri = {
+        .uri = "/status",
+        .method = HTTP_GET,
+        .handler = http_status_handler,
+    };
+    httpd_register_uri_handler (s_server, &scan_uri);
+    httpd_register_uri_handler (s_server, &status_uri);
+    portENTER_CRITICAL (&s_scan_lock);
+    s_scan_enabled = true;
+    portEXIT_CRITICAL (&s_scan_lock);
+    ESP_LOGI (TAG, "HTTP server listening on port %d", CONFIG_WIFI_STA_HTTP_PORT);
+    return ESP_OK;
+}
+
+esp_err_t wifi_sta_http_stop(void)
+{
+    if (s_server == NULL){
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t esp_ret = httpd_stop (s_server);
+    s_server = NULL;
+    // Drop the published results, later wifi_sta_http_set_scan() calls are refused
+    portENTER_CRITICAL (&s_scan_lock);
+    s_scan_enabled = false;
+    http_scan_t *old_scan = s_scan;
+    s_scan = NULL;
+    portEXIT_CRITICAL (&s_scan_lock);
+    http_scan_release (old_scan);
+    return esp_ret;
+}
+
+esp_err_t wifi_sta_http_set_scan(wifi_ap_record_t *ap_record, uint16_t ap_num)
+{
+    http_scan_t *scan = NULL;
+    if (ap_record != NULL){
+        scan = malloc (sizeof(http_scan_t));
+        if (scan == NULL){
+            return ESP_ERR_NO_MEM;
+        }
+        scan->ap_record = ap_record;
+        scan->ap_num = ap_num;
+        scan->refs = 1;     // Reference of the publication itself
+    }
+    portENTER_CRITICAL (&s_scan_lock);
+    bool enabled = s_scan_enabled;
+    http_scan_t *old_scan = NULL;
+    if (enabled){
+        old_scan = s_scan;
+        s_scan = scan;
+    }
+    portEXIT_CRITICAL (&s_scan_lock);
+    if (!enabled){
+        ESP_LOGE (TAG, "HTTP server is not started");
+        free (scan);
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Freed now, or by the last response still streaming it
+    http_scan_release (old_scan);
+    return ESP_OK;
+}
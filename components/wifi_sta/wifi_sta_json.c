@@ -0,0 +1,290 @@
+#include "wifi_sta_json.h"
+#include <string.h>
+
+/******************************
+ * Private functions prototypes
+ */
+
+static void json_flush (wifi_sta_json_t *json);
+
+static void json_put_char (wifi_sta_json_t *json, char c);
+
+static void json_put_raw (wifi_sta_json_t *json, const char *data, size_t len);
+
+static size_t json_utf8_len (const uint8_t *value, size_t max_len);
+
+static void json_put_string (wifi_sta_json_t *json, const char *value, size_t max_len);
+
+static void json_begin_value (wifi_sta_json_t *json, const char *key);
+
+static void json_container_begin (wifi_sta_json_t *json, const char *key, char open);
+
+static void json_container_end (wifi_sta_json_t *json, char close);
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+static void json_flush (wifi_sta_json_t *json)
+{
+    if (json->err == ESP_OK && json->len > 0){
+        json->err = json->flush (json->ctx, json->buf, json->len);
+    }
+    json->len = 0;
+}
+
+static void json_put_char (wifi_sta_json_t *json, char c)
+{
+    if (json->len == json->size){
+        json_flush (json);
+    }
+    if (json->err != ESP_OK){
+        return;
+    }
+    json->buf[json->len++] = c;
+    json->total++;
+}
+
+static void json_put_raw (wifi_sta_json_t *json, const char *data, size_t len)
+{
+    while (len > 0 && json->err == ESP_OK){
+        if (json->len == json->size){
+            json_flush (json);
+            continue;
+        }
+        size_t room = json->size - json->len;
+        size_t n = len < room ? len : room;
+        memcpy (json->buf + json->len, data, n);
+        json->len += n;
+        json->total += n;
+        data += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief Quoted and escaped string, stops at NUL or max_len
+ */
+/**
+ * @brief Length of the well-formed UTF-8 sequence starting at value[0] (>= 0x80), 0 if invalid
+ * Overlong forms, surrogates and code points above U+10FFFF are invalid.
+ */
+static size_t json_utf8_len (const uint8_t *value, size_t max_len)
+{
+    uint8_t c = value[0];
+    size_t len;
+    uint8_t min = 0x80, max = 0xBF;     // Range of the second byte
+    if (c >= 0xC2 && c <= 0xDF){
+        len = 2;
+    }
+    else if (c >= 0xE0 && c <= 0xEF){
+        len = 3;
+        if (c == 0xE0){
+            min = 0xA0;
+        }
+        else if (c == 0xED){
+            max = 0x9F;
+        }
+    }
+    else if (c >= 0xF0 && c <= 0xF4){
+        len = 4;
+        if (c == 0xF0){
+            min = 0x90;
+        }
+        else if (c == 0xF4){
+            max = 0x8F;
+        }
+    }
+    else {
+        return 0;
+    }
+    if (len > max_len || value[1] < min || value[1] > max){
+        return 0;
+    }
+    for (size_t i = 2; i < len; i++){
+        if (value[i] < 0x80 || value[i] > 0xBF){
+            return 0;
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Quoted string, escaped as needed
+ * SSIDs are arbitrary octets: bytes that are not part of valid UTF-8 are written as \u00XX.
+ */
+static void json_put_string (wifi_sta_json_t *json, const char *value, size_t max_len)
+{
+    static const char hex[] = "0123456789abcdef";
+    const uint8_t *bytes = (const uint8_t*) value;
+    json_put_char (json, '"');
+    for (size_t i = 0; i < max_len && bytes[i] != '\0'; i++){
+        uint8_t c = bytes[i];
+        if (c == '"' || c == '\\'){
+            json_put_char (json, '\\');
+            json_put_char (json, (char) c);
+            continue;
+        }
+        if (c >= 0x80){
+            // A NUL ends the string, so it also ends a truncated sequence
+            size_t len = json_utf8_len (&bytes[i], max_len - i);
+            if (len != 0){
+                json_put_raw (json, &value[i], len);
+                i += len - 1;
+                continue;
+            }
+        }
+        if (c < 0x20 || c >= 0x80){
+            char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F] };
+            json_put_raw (json, escaped, sizeof(escaped));
+        }
+        else {
+            json_put_char (json, (char) c);
+        }
+    }
+    json_put_char (json, '"');
+}
+
+/**
+ * @brief Separator and member name before any value
+ */
+static void json_begin_value (wifi_sta_json_t *json, const char *key)
+{
+    uint32_t level = 1UL << json->depth;
+    if (json->has_member & level){
+        json_put_char (json, ',');
+    }
+    json->has_member |= level;
+    if (key != NULL){
+        json_put_string (json, key, SIZE_MAX);
+        json_put_char (json, ':');
+    }
+}
+
+static void json_container_begin (wifi_sta_json_t *json, const char *key, char open)
+{
+    json_begin_value (json, key);
+    json_put_char (json, open);
+    if (json->depth + 1 >= WIFI_STA_JSON_MAX_DEPTH){
+        json->err = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    json->depth++;
+    json->has_member &= ~(1UL << json->depth);
+}
+
+static void json_container_end (wifi_sta_json_t *json, char close)
+{
+    if (json->depth == 0){
+        json->err = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    json->depth--;
+    json_put_char (json, close);
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+void wifi_sta_json_init(wifi_sta_json_t *json, char *buf, size_t size,
+                        wifi_sta_json_flush_t flush, void *ctx)
+{
+    memset (json, 0, sizeof(*json));
+    json->buf = buf;
+    json->size = size;
+    json->flush = flush;
+    json->ctx = ctx;
+    json->err = (buf == NULL || size == 0 || flush == NULL) ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+void wifi_sta_json_object_begin(wifi_sta_json_t *json, const char *key)
+{
+    json_container_begin (json, key, '{');
+}
+
+void wifi_sta_json_object_end(wifi_sta_json_t *json)
+{
+    json_container_end (json, '}');
+}
+
+void wifi_sta_json_array_begin(wifi_sta_json_t *json, const char *key)
+{
+    json_container_begin (json, key, '[');
+}
+
+void wifi_sta_json_array_end(wifi_sta_json_t *json)
+{
+    json_container_end (json, ']');
+}
+
+void wifi_sta_json_string(wifi_sta_json_t *json, const char *key, const char *value, size_t max_len)
+{
+    json_begin_value (json, key);
+    if (value == NULL){
+        json_put_raw (json, "null", 4);
+        return;
+    }
+    json_put_string (json, value, max_len);
+}
+
+void wifi_sta_json_int(wifi_sta_json_t *json, const char *key, int64_t value)
+{
+    char digits[20];
+    size_t n = 0;
+    // Work on the magnitude as unsigned so INT64_MIN is handled
+    uint64_t magnitude = value < 0 ? (uint64_t) 0 - (uint64_t) value : (uint64_t) value;
+    json_begin_value (json, key);
+    if (value < 0){
+        json_put_char (json, '-');
+    }
+    do {
+        digits[n++] = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    while (n > 0){
+        json_put_char (json, digits[--n]);
+    }
+}
+
+void wifi_sta_json_bool(wifi_sta_json_t *json, const char *key, bool value)
+{
+    json_begin_value (json, key);
+    if (value){
+        json_put_raw (json, "true", 4);
+    }
+    else {
+        json_put_raw (json, "false", 5);
+    }
+}
+
+void wifi_sta_json_ap_record(wifi_sta_json_t *json, const char *key, const wifi_ap_record_t *ap_record)
+{
+    static const char hex[] = "0123456789abcdef";
+    char bssid[17];
+    for (int i = 0; i < 6; i++){
+        bssid[i * 3] = hex[ap_record->bssid[i] >> 4];
+        bssid[i * 3 + 1] = hex[ap_record->bssid[i] & 0x0F];
+        if (i < 5){
+            bssid[i * 3 + 2] = ':';
+        }
+    }
+    wifi_sta_json_object_begin (json, key);
+    wifi_sta_json_string (json, "ssid", (const char*) ap_record->ssid, sizeof(ap_record->ssid));
+    wifi_sta_json_string (json, "bssid", bssid, sizeof(bssid));
+    wifi_sta_json_int (json, "channel", ap_record->primary);
+    wifi_sta_json_int (json, "rssi", ap_record->rssi);
+    wifi_sta_json_int (json, "authmode", ap_record->authmode);
+    wifi_sta_json_object_end (json);
+}
+
+esp_err_t wifi_sta_json_finish(wifi_sta_json_t *json)
+{
+    if (json->err == ESP_OK && json->depth != 0){
+        json->err = ESP_ERR_INVALID_STATE;
+    }
+    json_flush (json);
+    return json->err;
+}
@@ -0,0 +1,276 @@
+#include "wifi_sta_profile.h"
+#include "wifi_sta.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "lwip/sockets.h"
+#include <inttypes.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+// Tag for debug messages
+static const char* TAG = "WIFI_STA_PROFILE";
+
+#define PROFILE_RX_BUF_SIZE         4096
+#define PROFILE_ACCEPT_TIMEOUT_S    60
+
+/**
+ * @brief Settings tuned together by a profile
+ * The block ack window must not exceed the dynamic RX buffers nor twice the static RX buffers.
+ */
+typedef struct {
+    bool tuned;                 // false: keep the ESP-IDF menuconfig settings
+    int static_rx_buf_num;
+    int dynamic_rx_buf_num;
+    int dynamic_tx_buf_num;
+    int ampdu_rx_enable;
+    int ampdu_tx_enable;
+    int rx_ba_win;
+    int cache_tx_buf_num;       // TX frames cached in PSRAM while the air is busy (PSRAM only)
+    int amsdu_tx_enable;        // PSRAM only
+    wifi_ps_type_t ps;
+} profile_params_t;
+
+static const profile_params_t s_profile_params[WIFI_STA_PROFILE_MAX] = {
+    [WIFI_STA_PROFILE_HIGH_THROUGHPUT] = {
+        .tuned = true,
+        .static_rx_buf_num = 16,
+        .dynamic_rx_buf_num = 64,
+        .dynamic_tx_buf_num = 64,
+        .ampdu_rx_enable = 1,
+        .ampdu_tx_enable = 1,
+        .rx_ba_win = 32,
+        .cache_tx_buf_num = 64,
+        .amsdu_tx_enable = 1,
+        .ps = WIFI_PS_NONE,
+    },
+    [WIFI_STA_PROFILE_BALANCED] = {
+        .tuned = false,
+    },
+    [WIFI_STA_PROFILE_LOW_MEMORY] = {
+        .tuned = true,
+        .static_rx_buf_num = 4,
+        .dynamic_rx_buf_num = 8,
+        .dynamic_tx_buf_num = 8,
+        .ampdu_rx_enable = 1,
+        .ampdu_tx_enable = 0,
+        .rx_ba_win = 4,
+        .cache_tx_buf_num = 0,
+        .amsdu_tx_enable = 0,
+        .ps = WIFI_PS_MIN_MODEM,
+    },
+};
+
+static const char *s_profile_names[WIFI_STA_PROFILE_MAX] = {
+    [WIFI_STA_PROFILE_HIGH_THROUGHPUT] = "high-throughput",
+    [WIFI_STA_PROFILE_BALANCED] = "balanced",
+    [WIFI_STA_PROFILE_LOW_MEMORY] = "low-memory",
+};
+
+// Static global variables
+static wifi_sta_profile_t s_profile = CONFIG_WIFI_STA_PROFILE;
+static wifi_sta_profile_report_t s_report;
+
+/******************************
+ * Private functions prototypes
+ */
+
+static size_t profile_heap_used (size_t before, size_t after);
+static void profile_log (const wifi_sta_profile_report_t *report);
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+/**
+ * @brief Drop of a free heap size, 0 if other tasks freed more than WiFi allocated
+ */
+static size_t profile_heap_used (size_t before, size_t after)
+{
+    return before > after ? before - after : 0;
+}
+
+static void profile_log (const wifi_sta_profile_report_t *report)
+{
+    ESP_LOGI (TAG, "Profile %s: internal heap -%u bytes (min free %u), PSRAM -%u bytes, RX %" PRIu32 " kbit/s",
+              wifi_sta_profile_name (report->profile),
+              (unsigned) profile_heap_used (report->internal_before, report->internal_after),
+              (unsigned) report->internal_min,
+              (unsigned) profile_heap_used (report->psram_before, report->psram_after),
+              report->rx_kbps);
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+esp_err_t wifi_sta_profile_set(wifi_sta_profile_t profile)
+{
+    if (profile >= WIFI_STA_PROFILE_MAX){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (e_wifi_event_group != NULL){
+        ESP_LOGE (TAG, "WiFi is already initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_profile = profile;
+    return ESP_OK;
+}
+
+wifi_sta_profile_t wifi_sta_profile_get(void)
+{
+    return s_profile;
+}
+
+const char *wifi_sta_profile_name(wifi_sta_profile_t profile)
+{
+    return profile < WIFI_STA_PROFILE_MAX ? s_profile_names[profile] : "unknown";
+}
+
+void wifi_sta_profile_apply(wifi_init_config_t *cfg)
+{
+    memset (&s_report, 0, sizeof(s_report));
+    s_report.profile = s_profile;
+    s_report.internal_before = heap_caps_get_free_size (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_report.psram_before = heap_caps_get_free_size (MALLOC_CAP_SPIRAM);
+
+#if CONFIG_SPIRAM && !CONFIG_SPIRAM_TRY_ALLOCATE_WIFI_LWIP
+    // Only the Kconfig choice implies PSRAM buffers, a profile set at runtime cannot move them
+    if (s_profile == WIFI_STA_PROFILE_LOW_MEMORY){
+        ESP_LOGW (TAG, "WiFi and LWIP buffers stay in internal RAM, enable CONFIG_SPIRAM_TRY_ALLOCATE_WIFI_LWIP");
+    }
+#endif
+    const profile_params_t *params = &s_profile_params[s_profile];
+    if (!params->tuned){
+        return;
+    }
+    cfg->static_rx_buf_num = params->static_rx_buf_num;
+    cfg->dynamic_rx_buf_num = params->dynamic_rx_buf_num;
+    cfg->tx_buf_type = 1;   // Dynamic TX buffers, only allocated while frames are queued
+    cfg->dynamic_tx_buf_num = params->dynamic_tx_buf_num;
+    cfg->ampdu_rx_enable = params->ampdu_rx_enable;
+    cfg->ampdu_tx_enable = params->ampdu_tx_enable;
+    cfg->rx_ba_win = params->rx_ba_win;
+#if CONFIG_SPIRAM
+    if (params->cache_tx_buf_num > 0){
+        cfg->cache_tx_buf_num = params->cache_tx_buf_num;
+        cfg->feature_caps |= CONFIG_FEATURE_CACHE_TX_BUF_BIT;
+    }
+    cfg->amsdu_tx_enable = params->amsdu_tx_enable;
+#endif
+}
+
+esp_err_t wifi_sta_profile_finish(void)
+{
+    esp_err_t esp_ret = ESP_OK;
+    const profile_params_t *params = &s_profile_params[s_profile];
+    if (params->tuned){
+        esp_ret = esp_wifi_set_ps (params->ps);
+    }
+    s_report.internal_after = heap_caps_get_free_size (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_report.internal_min = s_report.internal_after;
+    s_report.psram_after = heap_caps_get_free_size (MALLOC_CAP_SPIRAM);
+    // Other tasks allocating meanwhile are counted too (wifi_sta_profile_report_t)
+    ESP_LOGI (TAG, "Profile %s: internal heap dropped by %u bytes during WiFi init",
+              wifi_sta_profile_name (s_profile),
+              (unsigned) profile_heap_used (s_report.internal_before, s_report.internal_after));
+    return esp_ret;
+}
+
+esp_err_t wifi_sta_profile_get_report(wifi_sta_profile_report_t *report)
+{
+    if (report == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    *report = s_report;
+    return ESP_OK;
+}
+
+esp_err_t wifi_sta_profile_measure(uint16_t port, uint32_t duration_ms, wifi_sta_profile_report_t *report)
+{
+    esp_err_t esp_ret = ESP_OK;
+    int client_sock = -1;
+    uint8_t *rx_buf = malloc (PROFILE_RX_BUF_SIZE);
+    if (rx_buf == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    int listen_sock = socket (AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (listen_sock < 0){
+        ESP_LOGE (TAG, "Failed to create socket");
+        free (rx_buf);
+        return ESP_FAIL;
+    }
+    int reuse = 1;
+    setsockopt (listen_sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons (port),
+        .sin_addr.s_addr = htonl (INADDR_ANY),
+    };
+    if (bind (listen_sock, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen (listen_sock, 1) != 0){
+        ESP_LOGE (TAG, "Failed to listen on port %u", port);
+        esp_ret = ESP_FAIL;
+        goto exit;
+    }
+
+    ESP_LOGI (TAG, "Waiting for a TCP sender on port %u (iperf -c <device IP> -p %u)", port, port);
+    fd_set accept_set;
+    FD_ZERO (&accept_set);
+    FD_SET (listen_sock, &accept_set);
+    struct timeval accept_timeout = { .tv_sec = PROFILE_ACCEPT_TIMEOUT_S };
+    if (select (listen_sock + 1, &accept_set, NULL, NULL, &accept_timeout) <= 0){
+        ESP_LOGE (TAG, "No sender connected");
+        esp_ret = ESP_ERR_TIMEOUT;
+        goto exit;
+    }
+    client_sock = accept (listen_sock, NULL, NULL);
+    if (client_sock < 0){
+        esp_ret = ESP_FAIL;
+        goto exit;
+    }
+    // Wake up at least every second to check the duration
+    struct timeval rx_timeout = { .tv_sec = 1 };
+    setsockopt (client_sock, SOL_SOCKET, SO_RCVTIMEO, &rx_timeout, sizeof(rx_timeout));
+
+    // Dynamic buffers are only allocated under traffic: track the lowest free heap
+    uint64_t rx_bytes = 0;
+    size_t internal_min = heap_caps_get_free_size (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    int64_t start_us = esp_timer_get_time();
+    int64_t elapsed_us = 0;
+    while (elapsed_us < (int64_t) duration_ms * 1000){
+        int len = recv (client_sock, rx_buf, PROFILE_RX_BUF_SIZE, 0);
+        elapsed_us = esp_timer_get_time() - start_us;
+        if (len == 0){
+            break;
+        }
+        if (len < 0){
+            if (errno == EAGAIN || errno == EWOULDBLOCK){
+                continue;
+            }
+            break;
+        }
+        rx_bytes += len;
+        size_t internal_free = heap_caps_get_free_size (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (internal_free < internal_min){
+            internal_min = internal_free;
+        }
+    }
+    s_report.internal_min = internal_min;
+    s_report.rx_bytes = rx_bytes;
+    s_report.duration_ms = (uint32_t) (elapsed_us / 1000);
+    s_report.rx_kbps = elapsed_us > 0 ? (uint32_t) (rx_bytes * 8 * 1000 / elapsed_us) : 0;
+    profile_log (&s_report);
+exit:
+    if (client_sock >= 0){
+        close (client_sock);
+    }
+    close (listen_sock);
+    free (rx_buf);
+    if (report != NULL){
+        *report = s_report;
+    }
+    return esp_ret;
+}
@@ -1,4 +1,5 @@
 #include "wifi_sta.h"
+#include "wifi_sta_trace.h"
 #include "esp_err.h"
 #include "esp_private/wifi.h"
 #include "freertos/event_groups.h"
@@ -93,20 +94,19 @@ esp_err_t wifi_sta_scan_read(wifi_ap_record_t **ap_record){
         ESP_LOGE (TAG, "Failed to get AP record");
         if (s_ap_record != NULL){
             // Delete previous the scan
-            ESP_LOGI (TAG, "Free previously allocated");
             free ((void*)s_ap_record);    
         }
         return ESP_FAIL;
     }
+    WIFI_STA_TRACE_I (WIFI_STA_TRACE_SCAN_NUM, s_ap_num, 0);
     for (int i = 0; i < s_ap_num ; i++ ){
         (*ap_record)[i] = s_ap_record[i];
-        ESP_LOGI (TAG, "Scanned wifi: %d", i);
-        ESP_LOGI (TAG, "SSID: %s", s_ap_record[i].ssid);
-        ESP_LOGI (TAG, "Auth Mode %d", s_ap_record[i].authmode);
+        WIFI_STA_TRACE_AP_V (WIFI_STA_TRACE_SCAN_AP,
+                             (i & 0xFF) | (s_ap_record[i].primary << 8) | (s_ap_record[i].authmode << 16) | ((uint32_t)(uint8_t)s_ap_record[i].rssi << 24),
+                             s_ap_record[i].bssid, s_ap_record[i].ssid);
     }
     if (s_ap_record != NULL){
         // Free s_ap_record
-        ESP_LOGI (TAG, "Free previously allocated");
         free ((void*)s_ap_record);    
     }
     xEventGroupClearBits (e_wifi_event_group,WIFI_STA_SCAN_START);
@@ -0,0 +1,236 @@
+#include "wifi_sta.h"
+#include "esp_err.h"
+#include <string.h>
+// Tag for debug messages
+static const char* TAG = "WIFI_STA_SCAN_FILTER";
+
+// SSID index used by dedupe: open addressing on the stack (2 bytes per slot, power of two)
+#define SCAN_DEDUPE_SLOTS       256
+#define SCAN_DEDUPE_MAX_LOAD    (SCAN_DEDUPE_SLOTS * 3 / 4)
+#define SCAN_DEDUPE_EMPTY       UINT16_MAX
+
+/**
+ * @brief Dedupe state: kept records [0, indexed_end) are in the index, later ones are searched linearly
+ */
+typedef struct {
+    uint16_t slots[SCAN_DEDUPE_SLOTS];
+    uint16_t count;
+    uint16_t indexed_end;
+} scan_dedupe_t;
+
+/******************************
+ * Private functions prototypes
+ */
+
+static bool scan_filter_match (const wifi_ap_record_t *ap,
+                               const wifi_sta_scan_filter_t *filter,
+                               bool any_channel);
+
+static bool scan_channel_mask_empty (const wifi_sta_scan_filter_t *filter);
+
+static uint32_t scan_ssid_hash (const uint8_t *ssid, size_t max_len);
+
+static int scan_dedupe_find (scan_dedupe_t *dedupe,
+                             const wifi_ap_record_t *ap_record,
+                             uint16_t kept,
+                             const uint8_t *ssid);
+
+static void scan_heap_sift_down (wifi_ap_record_t *heap, uint16_t len, uint16_t root);
+
+static void scan_select_top_k (wifi_ap_record_t *ap_record, uint16_t ap_num, uint16_t k);
+
+static inline void scan_swap (wifi_ap_record_t *a, wifi_ap_record_t *b);
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+static inline void scan_swap (wifi_ap_record_t *a, wifi_ap_record_t *b)
+{
+    wifi_ap_record_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+/**
+ * @brief Check one AP against the SSID, auth mode, channel and RSSI options
+ */
+static bool scan_filter_match (const wifi_ap_record_t *ap,
+                               const wifi_sta_scan_filter_t *filter,
+                               bool any_channel)
+{
+    if (ap->rssi < filter->rssi_floor){
+        return false;
+    }
+    if (ap->authmode < filter->min_authmode){
+        return false;
+    }
+    if (!any_channel && !WIFI_STA_SCAN_CHANNEL_IS_SET(filter->channel_mask, ap->primary)){
+        return false;
+    }
+    if (filter->ssid != NULL){
+        if (strncmp ((const char*)ap->ssid, filter->ssid, sizeof(ap->ssid)) != 0){
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool scan_channel_mask_empty (const wifi_sta_scan_filter_t *filter)
+{
+    for (int i = 0; i < WIFI_STA_SCAN_CHANNEL_WORDS; i++){
+        if (filter->channel_mask[i] != 0){
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t scan_ssid_hash (const uint8_t *ssid, size_t max_len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < max_len && ssid[i] != '\0'; i++){
+        hash = (hash ^ ssid[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Find a kept record with the same SSID, index the SSID if it is new
+ * Once the index is full, the remaining new SSIDs are searched linearly.
+ * @return Index of the record, -1 if not found (ap_record[kept] will hold it)
+ */
+static int scan_dedupe_find (scan_dedupe_t *dedupe,
+                             const wifi_ap_record_t *ap_record,
+                             uint16_t kept,
+                             const uint8_t *ssid)
+{
+    const size_t ssid_len = sizeof(ap_record[0].ssid);
+    uint32_t slot = scan_ssid_hash (ssid, ssid_len) & (SCAN_DEDUPE_SLOTS - 1);
+    while (dedupe->slots[slot] != SCAN_DEDUPE_EMPTY){
+        uint16_t index = dedupe->slots[slot];
+        if (strncmp ((const char*)ap_record[index].ssid, (const char*)ssid, ssid_len) == 0){
+            return index;
+        }
+        slot = (slot + 1) & (SCAN_DEDUPE_SLOTS - 1);
+    }
+    for (uint16_t i = dedupe->indexed_end; i < kept; i++){
+        if (strncmp ((const char*)ap_record[i].ssid, (const char*)ssid, ssid_len) == 0){
+            return i;
+        }
+    }
+    if (dedupe->count < SCAN_DEDUPE_MAX_LOAD){
+        dedupe->slots[slot] = kept;
+        dedupe->count++;
+        dedupe->indexed_end = kept + 1;
+    }
+    return -1;
+}
+
+/**
+ * @brief Restore the min-heap (by RSSI) property below root
+ */
+static void scan_heap_sift_down (wifi_ap_record_t *heap, uint16_t len, uint16_t root)
+{
+    while (1){
+        uint16_t weakest = root;
+        uint16_t left = 2 * root + 1;
+        uint16_t right = left + 1;
+        if (left < len && heap[left].rssi < heap[weakest].rssi){
+            weakest = left;
+        }
+        if (right < len && heap[right].rssi < heap[weakest].rssi){
+            weakest = right;
+        }
+        if (weakest == root){
+            return;
+        }
+        scan_swap (&heap[root], &heap[weakest]);
+        root = weakest;
+    }
+}
+
+/**
+ * @brief Partial sort: move the k strongest APs to the front, strongest first
+ * A min-heap of size k holds the current top-K, so the cost is O(n log k)
+ */
+static void scan_select_top_k (wifi_ap_record_t *ap_record, uint16_t ap_num, uint16_t k)
+{
+    if (k > ap_num){
+        k = ap_num;
+    }
+    if (k == 0){
+        return;
+    }
+    // Build a min-heap from the first k records
+    for (uint16_t i = k / 2; i-- > 0;){
+        scan_heap_sift_down (ap_record, k, i);
+    }
+    // Replace the weakest of the top-K whenever a stronger AP is found
+    for (uint16_t i = k; i < ap_num; i++){
+        if (ap_record[i].rssi > ap_record[0].rssi){
+            scan_swap (&ap_record[0], &ap_record[i]);
+            scan_heap_sift_down (ap_record, k, 0);
+        }
+    }
+    // Sort the heap: popping the weakest to the back leaves the strongest first
+    for (uint16_t end = k; end-- > 1;){
+        scan_swap (&ap_record[0], &ap_record[end]);
+        scan_heap_sift_down (ap_record, end, 0);
+    }
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+esp_err_t wifi_sta_scan_filter(wifi_ap_record_t *ap_record,
+                               uint16_t *ap_num,
+                               const wifi_sta_scan_filter_t *filter)
+{
+    if (ap_record == NULL || ap_num == NULL || filter == NULL){
+        ESP_LOGE (TAG, "Invalid argument");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Match and dedupe in one pass, kept records are compacted to the front
+    scan_dedupe_t dedupe;
+    if (filter->dedupe_ssid){
+        memset (dedupe.slots, 0xFF, sizeof(dedupe.slots));
+        dedupe.count = 0;
+        dedupe.indexed_end = 0;
+    }
+    bool any_channel = scan_channel_mask_empty (filter);
+    uint16_t kept = 0;
+    for (uint16_t i = 0; i < *ap_num; i++){
+        if (!scan_filter_match (&ap_record[i], filter, any_channel)){
+            continue;
+        }
+        // Hidden networks have no SSID to dedupe on
+        if (filter->dedupe_ssid && ap_record[i].ssid[0] != '\0'){
+            int same = scan_dedupe_find (&dedupe, ap_record, kept, ap_record[i].ssid);
+            if (same >= 0){
+                if (ap_record[i].rssi > ap_record[same].rssi){
+                    ap_record[same] = ap_record[i];
+                }
+                continue;
+            }
+        }
+        if (kept != i){
+            ap_record[kept] = ap_record[i];
+        }
+        kept++;
+    }
+
+    if (filter->top_k != 0){
+        scan_select_top_k (ap_record, kept, filter->top_k);
+        if (kept > filter->top_k){
+            kept = filter->top_k;
+        }
+    }
+    *ap_num = kept;
+    return ESP_OK;
+}
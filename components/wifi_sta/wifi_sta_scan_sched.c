@@ -0,0 +1,290 @@
+#include "wifi_sta_scan_sched.h"
+#include "wifi_sta_trace.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+// Tag for debug messages
+static const char* TAG = "WIFI_STA_SCAN_SCHED";
+
+/**
+ * @brief What is remembered of an AP between two scans
+ */
+typedef struct {
+    uint8_t bssid[6];
+    int8_t rssi;
+} sched_fingerprint_t;
+
+// Static global variables
+static sched_fingerprint_t s_fingerprints[2][CONFIG_WIFI_STA_SCAN_SCHED_MAX_AP];
+static uint8_t s_prev_index = 0;       // s_fingerprints[s_prev_index] holds the previous scan
+static uint16_t s_prev_num = 0;
+static int8_t s_prev_cutoff = INT8_MIN;  // Weakest remembered RSSI when APs were left out
+static bool s_has_prev = false;
+static uint32_t s_min_period_ms = CONFIG_WIFI_STA_SCAN_SCHED_MIN_MS;
+static uint32_t s_max_period_ms = CONFIG_WIFI_STA_SCAN_SCHED_MAX_MS;
+static uint32_t s_period_ms = CONFIG_WIFI_STA_SCAN_SCHED_MIN_MS;
+static wifi_sta_scan_sched_entry_t s_history[CONFIG_WIFI_STA_SCAN_SCHED_HISTORY];
+static uint16_t s_history_head = 0;
+static uint16_t s_history_count = 0;
+static portMUX_TYPE s_sched_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************
+ * Private functions prototypes
+ */
+
+static void sched_record (wifi_sta_scan_sched_entry_t *entry);
+
+static int sched_find (const sched_fingerprint_t *fingerprints, uint16_t num, const uint8_t *bssid);
+
+static bool sched_in_scan (const wifi_ap_record_t *ap_record, uint16_t ap_num, const uint8_t *bssid);
+
+static bool sched_stronger (const sched_fingerprint_t *a, const sched_fingerprint_t *b);
+
+static uint16_t sched_weakest (const sched_fingerprint_t *fingerprints, uint16_t num);
+
+static uint16_t sched_select (const wifi_ap_record_t *ap_record, uint16_t ap_num,
+                              sched_fingerprint_t *fingerprints, int8_t *cutoff, uint16_t *above_floor);
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+/**
+ * @brief Append a decision to the history ring (call with s_sched_lock held)
+ */
+static void sched_record (wifi_sta_scan_sched_entry_t *entry)
+{
+    s_history[s_history_head] = *entry;
+    s_history_head = (s_history_head + 1) % CONFIG_WIFI_STA_SCAN_SCHED_HISTORY;
+    if (s_history_count < CONFIG_WIFI_STA_SCAN_SCHED_HISTORY){
+        s_history_count++;
+    }
+}
+
+static int sched_find (const sched_fingerprint_t *fingerprints, uint16_t num, const uint8_t *bssid)
+{
+    for (int i = 0; i < num; i++){
+        if (memcmp (fingerprints[i].bssid, bssid, sizeof(fingerprints[i].bssid)) == 0){
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief BSSID in the scan above the RSSI floor
+ */
+static bool sched_in_scan (const wifi_ap_record_t *ap_record, uint16_t ap_num, const uint8_t *bssid)
+{
+    for (uint16_t i = 0; i < ap_num; i++){
+        if (ap_record[i].rssi >= CONFIG_WIFI_STA_SCAN_SCHED_RSSI_FLOOR &&
+            memcmp (ap_record[i].bssid, bssid, sizeof(ap_record[i].bssid)) == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Stronger RSSI first, ties broken by BSSID
+ */
+static bool sched_stronger (const sched_fingerprint_t *a, const sched_fingerprint_t *b)
+{
+    if (a->rssi != b->rssi){
+        return a->rssi > b->rssi;
+    }
+    return memcmp (a->bssid, b->bssid, sizeof(a->bssid)) < 0;
+}
+
+static uint16_t sched_weakest (const sched_fingerprint_t *fingerprints, uint16_t num)
+{
+    uint16_t weakest = 0;
+    for (uint16_t i = 1; i < num; i++){
+        if (sched_stronger (&fingerprints[weakest], &fingerprints[i])){
+            weakest = i;
+        }
+    }
+    return weakest;
+}
+
+/**
+ * @brief Remember the CONFIG_WIFI_STA_SCAN_SCHED_MAX_AP strongest APs above the RSSI floor
+ * The same APs are kept whatever the order of the records, so a crowded but
+ * stable scan does not show up as churn.
+ *
+ * @param[out] cutoff Weakest RSSI kept when APs were left out, INT8_MIN otherwise
+ * @param[out] above_floor APs above the RSSI floor, kept or not
+ *
+ * @return Number of APs kept
+ */
+static uint16_t sched_select (const wifi_ap_record_t *ap_record, uint16_t ap_num,
+                              sched_fingerprint_t *fingerprints, int8_t *cutoff, uint16_t *above_floor)
+{
+    uint16_t num = 0;
+    uint16_t weakest = 0;
+    *above_floor = 0;
+    for (uint16_t i = 0; i < ap_num; i++){
+        // APs near the sensitivity limit come and go, they are not churn
+        if (ap_record[i].rssi < CONFIG_WIFI_STA_SCAN_SCHED_RSSI_FLOOR){
+            continue;
+        }
+        (*above_floor)++;
+        sched_fingerprint_t ap = { .rssi = ap_record[i].rssi };
+        memcpy (ap.bssid, ap_record[i].bssid, sizeof(ap.bssid));
+        if (num < CONFIG_WIFI_STA_SCAN_SCHED_MAX_AP){
+            fingerprints[num++] = ap;
+            if (num == CONFIG_WIFI_STA_SCAN_SCHED_MAX_AP){
+                weakest = sched_weakest (fingerprints, num);
+            }
+        }
+        else if (sched_stronger (&ap, &fingerprints[weakest])){
+            fingerprints[weakest] = ap;
+            weakest = sched_weakest (fingerprints, num);
+        }
+    }
+    *cutoff = (*above_floor > num) ? fingerprints[weakest].rssi : INT8_MIN;
+    return num;
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+esp_err_t wifi_sta_scan_sched_init(uint32_t min_period_ms, uint32_t max_period_ms)
+{
+    if (min_period_ms == 0){
+        min_period_ms = CONFIG_WIFI_STA_SCAN_SCHED_MIN_MS;
+    }
+    if (max_period_ms == 0){
+        max_period_ms = CONFIG_WIFI_STA_SCAN_SCHED_MAX_MS;
+    }
+    if (min_period_ms > max_period_ms){
+        ESP_LOGE (TAG, "Minimum period is larger than maximum period");
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL (&s_sched_lock);
+    s_min_period_ms = min_period_ms;
+    s_max_period_ms = max_period_ms;
+    s_period_ms = min_period_ms;
+    s_has_prev = false;
+    s_prev_num = 0;
+    s_prev_cutoff = INT8_MIN;
+    s_history_head = 0;
+    s_history_count = 0;
+    portEXIT_CRITICAL (&s_sched_lock);
+    return ESP_OK;
+}
+
+uint32_t wifi_sta_scan_sched_update(const wifi_ap_record_t *ap_record, uint16_t ap_num)
+{
+    wifi_sta_scan_sched_entry_t entry = {
+        .timestamp_us = esp_timer_get_time(),
+    };
+    if (ap_record == NULL){
+        ap_num = 0;
+    }
+    uint16_t matched = 0;
+    uint16_t disappeared = 0;
+    uint32_t square_sum = 0;
+
+    // Held for the comparison too: at most MAX_AP x scan size BSSID compares
+    portENTER_CRITICAL (&s_sched_lock);
+    const sched_fingerprint_t *prev = s_fingerprints[s_prev_index];
+    sched_fingerprint_t *cur = s_fingerprints[s_prev_index ^ 1];
+    int8_t cur_cutoff;
+    uint16_t cur_num = sched_select (ap_record, ap_num, cur, &cur_cutoff, &entry.ap_num);
+
+    for (uint16_t i = 0; i < cur_num; i++){
+        int same = sched_find (prev, s_prev_num, cur[i].bssid);
+        if (same >= 0){
+            int32_t delta = cur[i].rssi - prev[same].rssi;
+            square_sum += delta * delta;
+            matched++;
+        }
+        // Too weak to be remembered last time: may have been there
+        else if (cur[i].rssi > s_prev_cutoff && entry.appeared < UINT8_MAX){
+            entry.appeared++;
+        }
+    }
+    for (uint16_t i = 0; i < s_prev_num; i++){
+        // Still in the scan but left out of the remembered APs: not gone
+        if (sched_find (cur, cur_num, prev[i].bssid) < 0 && !sched_in_scan (ap_record, ap_num, prev[i].bssid)){
+            disappeared++;
+        }
+    }
+    entry.disappeared = disappeared > UINT8_MAX ? UINT8_MAX : disappeared;
+
+    // Churn: share of the APs that changed, or RSSI movement, whichever is larger
+    uint32_t union_num = matched + entry.appeared + disappeared;
+    uint32_t set_score = union_num ? (uint32_t) (entry.appeared + disappeared) * 100 / union_num : 0;
+    uint32_t variance = matched ? square_sum / matched : 0;
+    uint32_t rssi_score = variance * 100 / CONFIG_WIFI_STA_SCAN_SCHED_RSSI_VARIANCE_FULL;
+    entry.rssi_variance = variance > UINT16_MAX ? UINT16_MAX : variance;
+    entry.churn = set_score > rssi_score ? set_score : (rssi_score > 100 ? 100 : rssi_score);
+
+    if (!s_has_prev){
+        entry.reason = WIFI_STA_SCAN_SCHED_FIRST;
+        s_period_ms = s_min_period_ms;
+    }
+    else if (entry.churn >= CONFIG_WIFI_STA_SCAN_SCHED_CHURN_HIGH){
+        entry.reason = WIFI_STA_SCAN_SCHED_CHURN;
+        s_period_ms = s_min_period_ms;
+    }
+    else if (entry.churn <= CONFIG_WIFI_STA_SCAN_SCHED_CHURN_LOW){
+        entry.reason = WIFI_STA_SCAN_SCHED_STABLE;
+        s_period_ms = (s_period_ms > s_max_period_ms / 2) ? s_max_period_ms : s_period_ms * 2;
+    }
+    else {
+        entry.reason = WIFI_STA_SCAN_SCHED_HOLD;
+    }
+    entry.period_ms = s_period_ms;
+    sched_record (&entry);
+    s_prev_index ^= 1;
+    s_prev_num = cur_num;
+    s_prev_cutoff = cur_cutoff;
+    s_has_prev = true;
+    portEXIT_CRITICAL (&s_sched_lock);
+
+    WIFI_STA_TRACE_I (WIFI_STA_TRACE_SCAN_SCHED, entry.churn | (entry.reason << 8), entry.period_ms);
+    return entry.period_ms;
+}
+
+void wifi_sta_scan_sched_notify_disconnect(void)
+{
+    wifi_sta_scan_sched_entry_t entry = {
+        .timestamp_us = esp_timer_get_time(),
+        .reason = WIFI_STA_SCAN_SCHED_DISCONNECT,
+    };
+    portENTER_CRITICAL (&s_sched_lock);
+    s_period_ms = s_min_period_ms;
+    entry.period_ms = s_period_ms;
+    sched_record (&entry);
+    portEXIT_CRITICAL (&s_sched_lock);
+    WIFI_STA_TRACE_I (WIFI_STA_TRACE_SCAN_SCHED, entry.reason << 8, entry.period_ms);
+}
+
+uint32_t wifi_sta_scan_sched_get_period(void)
+{
+    return s_period_ms;
+}
+
+uint16_t wifi_sta_scan_sched_get_history(wifi_sta_scan_sched_entry_t *history, uint16_t max_entries)
+{
+    if (history == NULL){
+        return 0;
+    }
+    portENTER_CRITICAL (&s_sched_lock);
+    uint16_t count = s_history_count < max_entries ? s_history_count : max_entries;
+    // Skip the oldest entries that do not fit
+    uint16_t index = (s_history_head + CONFIG_WIFI_STA_SCAN_SCHED_HISTORY - count) % CONFIG_WIFI_STA_SCAN_SCHED_HISTORY;
+    for (uint16_t i = 0; i < count; i++){
+        history[i] = s_history[index];
+        index = (index + 1) % CONFIG_WIFI_STA_SCAN_SCHED_HISTORY;
+    }
+    portEXIT_CRITICAL (&s_sched_lock);
+    return count;
+}
@@ -0,0 +1,246 @@
+#include "wifi_sta_trace.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+// Tag for debug messages
+static const char* TAG = "WIFI_STA_TRACE";
+
+#if CONFIG_WIFI_STA_TRACE_LEVEL > WIFI_STA_TRACE_LEVEL_NONE
+
+// Static global variables
+static wifi_sta_trace_record_t s_trace_buf[CONFIG_WIFI_STA_TRACE_BUF_RECORDS];
+static uint32_t s_trace_head = 0;      // Next slot to write
+static uint32_t s_trace_count = 0;     // Valid records in the buffer
+static uint32_t s_trace_dropped = 0;
+static bool s_trace_paused = false;    // Set while dumping
+static portMUX_TYPE s_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************
+ * Private functions prototypes
+ */
+
+static void trace_put (uint32_t timestamp_us, uint8_t level, uint16_t event_id, uint32_t arg0, uint32_t arg1);
+static uint32_t trace_ssid_hash (const uint8_t *ssid, size_t len);
+static uint32_t trace_pause (wifi_sta_trace_header_t *header);
+static void trace_resume (void);
+static void trace_print_hex (const void *data, size_t len);
+
+
+/*******************************
+ *  Private functions implementation
+ */
+
+/**
+ * @brief Store one record, called with s_trace_lock held
+ */
+static void trace_put (uint32_t timestamp_us, uint8_t level, uint16_t event_id, uint32_t arg0, uint32_t arg1)
+{
+    if (s_trace_paused){
+        s_trace_dropped++;
+        return;
+    }
+    wifi_sta_trace_record_t *record = &s_trace_buf[s_trace_head];
+    record->timestamp_us = timestamp_us;
+    record->core = (uint8_t) xPortGetCoreID();
+    record->level = level;
+    record->event_id = event_id;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+    s_trace_head = (s_trace_head + 1) % CONFIG_WIFI_STA_TRACE_BUF_RECORDS;
+    if (s_trace_count < CONFIG_WIFI_STA_TRACE_BUF_RECORDS){
+        s_trace_count++;
+    }
+    else {
+        // Oldest record overwritten
+        s_trace_dropped++;
+    }
+}
+
+static uint32_t trace_ssid_hash (const uint8_t *ssid, size_t len)
+{
+    // FNV-1a, same as the decoder
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++){
+        hash = (hash ^ ssid[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Stop recording and fill the dump header
+ * Records written while paused are counted as dropped.
+ * @return Index of the oldest record
+ */
+static uint32_t trace_pause (wifi_sta_trace_header_t *header)
+{
+    uint32_t oldest;
+    portENTER_CRITICAL_SAFE (&s_trace_lock);
+    s_trace_paused = true;
+    oldest = (s_trace_head + CONFIG_WIFI_STA_TRACE_BUF_RECORDS - s_trace_count) % CONFIG_WIFI_STA_TRACE_BUF_RECORDS;
+    header->magic = WIFI_STA_TRACE_MAGIC;
+    header->version = WIFI_STA_TRACE_VERSION;
+    header->record_size = sizeof(wifi_sta_trace_record_t);
+    header->record_count = s_trace_count;
+    header->dropped = s_trace_dropped;
+    portEXIT_CRITICAL_SAFE (&s_trace_lock);
+    return oldest;
+}
+
+static void trace_resume (void)
+{
+    portENTER_CRITICAL_SAFE (&s_trace_lock);
+    s_trace_paused = false;
+    portEXIT_CRITICAL_SAFE (&s_trace_lock);
+}
+
+static void trace_print_hex (const void *data, size_t len)
+{
+    const uint8_t *bytes = (const uint8_t*) data;
+    printf ("WSTRACE ");
+    for (size_t i = 0; i < len; i++){
+        printf ("%02x", bytes[i]);
+    }
+    printf ("\n");
+}
+
+
+/*******************************************************************
+ * Public function implement
+ */
+
+void wifi_sta_trace_write(uint8_t level, uint16_t event_id, uint32_t arg0, uint32_t arg1)
+{
+    // Timestamp taken under the lock so records are in time order across cores and ISRs
+    portENTER_CRITICAL_SAFE (&s_trace_lock);
+    trace_put ((uint32_t) esp_timer_get_time(), level, event_id, arg0, arg1);
+    portEXIT_CRITICAL_SAFE (&s_trace_lock);
+}
+
+void wifi_sta_trace_write_ap(uint8_t level, uint16_t event_id, uint32_t arg0,
+                             const uint8_t bssid[6], const uint8_t *ssid, size_t ssid_max_len)
+{
+    size_t ssid_len = strnlen ((const char*) ssid, ssid_max_len);
+    uint8_t chunk[8];
+    portENTER_CRITICAL_SAFE (&s_trace_lock);
+    uint32_t timestamp_us = (uint32_t) esp_timer_get_time();
+    trace_put (timestamp_us, level, event_id, arg0,
+               bssid[2] | (bssid[3] << 8) | (bssid[4] << 16) | ((uint32_t) bssid[5] << 24));
+    trace_put (timestamp_us, level, WIFI_STA_TRACE_AP_ID,
+               bssid[0] | (bssid[1] << 8) | (ssid_len << 16), trace_ssid_hash (ssid, ssid_len));
+    for (size_t offset = 0; offset < ssid_len; offset += sizeof(chunk)){
+        memset (chunk, 0, sizeof(chunk));
+        memcpy (chunk, ssid + offset, (ssid_len - offset < sizeof(chunk)) ? ssid_len - offset : sizeof(chunk));
+        trace_put (timestamp_us, level, WIFI_STA_TRACE_AP_SSID,
+                   chunk[0] | (chunk[1] << 8) | (chunk[2] << 16) | ((uint32_t) chunk[3] << 24),
+                   chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((uint32_t) chunk[7] << 24));
+    }
+    portEXIT_CRITICAL_SAFE (&s_trace_lock);
+}
+
+esp_err_t wifi_sta_trace_dump_uart(void)
+{
+    wifi_sta_trace_header_t header;
+    uint32_t index = trace_pause (&header);
+    trace_print_hex (&header, sizeof(header));
+    for (uint32_t i = 0; i < header.record_count; i++){
+        trace_print_hex (&s_trace_buf[index], sizeof(wifi_sta_trace_record_t));
+        index = (index + 1) % CONFIG_WIFI_STA_TRACE_BUF_RECORDS;
+    }
+    trace_resume ();
+    return ESP_OK;
+}
+
+esp_err_t wifi_sta_trace_dump_flash(void)
+{
+    const esp_partition_t *partition = esp_partition_find_first (ESP_PARTITION_TYPE_DATA,
+                                                                 ESP_PARTITION_SUBTYPE_ANY,
+                                                                 CONFIG_WIFI_STA_TRACE_PARTITION_LABEL);
+    if (partition == NULL){
+        ESP_LOGE (TAG, "Partition %s not found", CONFIG_WIFI_STA_TRACE_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    wifi_sta_trace_header_t header;
+    uint32_t oldest = trace_pause (&header);
+    size_t dump_size = sizeof(header) + header.record_count * sizeof(wifi_sta_trace_record_t);
+    size_t erase_size = (dump_size + partition->erase_size - 1) / partition->erase_size * partition->erase_size;
+    esp_err_t esp_ret = ESP_OK;
+    if (erase_size > partition->size){
+        ESP_LOGE (TAG, "Partition %s is too small for %u bytes", CONFIG_WIFI_STA_TRACE_PARTITION_LABEL, (unsigned) dump_size);
+        esp_ret = ESP_ERR_INVALID_SIZE;
+        goto exit;
+    }
+    esp_ret = esp_partition_erase_range (partition, 0, erase_size);
+    if (esp_ret != ESP_OK){
+        ESP_LOGE (TAG, "Failed to erase partition");
+        goto exit;
+    }
+    esp_ret = esp_partition_write (partition, 0, &header, sizeof(header));
+    if (esp_ret != ESP_OK){
+        ESP_LOGE (TAG, "Failed to write trace header");
+        goto exit;
+    }
+    // The ring may wrap: write [oldest, end) then [0, rest)
+    uint32_t first = CONFIG_WIFI_STA_TRACE_BUF_RECORDS - oldest;
+    if (first > header.record_count){
+        first = header.record_count;
+    }
+    esp_ret = esp_partition_write (partition, sizeof(header),
+                                   &s_trace_buf[oldest], first * sizeof(wifi_sta_trace_record_t));
+    if (esp_ret == ESP_OK && header.record_count > first){
+        esp_ret = esp_partition_write (partition, sizeof(header) + first * sizeof(wifi_sta_trace_record_t),
+                                       &s_trace_buf[0], (header.record_count - first) * sizeof(wifi_sta_trace_record_t));
+    }
+    if (esp_ret != ESP_OK){
+        ESP_LOGE (TAG, "Failed to write trace records");
+        goto exit;
+    }
+    ESP_LOGI (TAG, "Dumped %" PRIu32 " trace records to %s", header.record_count, CONFIG_WIFI_STA_TRACE_PARTITION_LABEL);
+exit:
+    trace_resume ();
+    return esp_ret;
+}
+
+void wifi_sta_trace_clear(void)
+{
+    portENTER_CRITICAL_SAFE (&s_trace_lock);
+    s_trace_head = 0;
+    s_trace_count = 0;
+    s_trace_dropped = 0;
+    portEXIT_CRITICAL_SAFE (&s_trace_lock);
+}
+
+#else // Trace disabled
+
+void wifi_sta_trace_write(uint8_t level, uint16_t event_id, uint32_t arg0, uint32_t arg1)
+{
+}
+
+void wifi_sta_trace_write_ap(uint8_t level, uint16_t event_id, uint32_t arg0,
+                             const uint8_t bssid[6], const uint8_t *ssid, size_t ssid_max_len)
+{
+}
+
+esp_err_t wifi_sta_trace_dump_uart(void)
+{
+    ESP_LOGE (TAG, "Trace is disabled (CONFIG_WIFI_STA_TRACE_LEVEL)");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t wifi_sta_trace_dump_flash(void)
+{
+    ESP_LOGE (TAG, "Trace is disabled (CONFIG_WIFI_STA_TRACE_LEVEL)");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void wifi_sta_trace_clear(void)
+{
+}
+
+#endif // CONFIG_WIFI_STA_TRACE_LEVEL
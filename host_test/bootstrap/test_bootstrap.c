@@ -0,0 +1,296 @@
+/**
+ * @brief Host test of the parallel init runner
+ * bootstrap.c is built as is on the pthread FreeRTOS stand-in, every step runs
+ * in its own thread. Steps sleep to give the runs a known shape: dependency
+ * order, overlap of independent steps, failure propagation through
+ * BOOTSTRAP_FAIL_BIT, the critical path report, and a timeout with the step
+ * array gone from the caller's stack before a stuck step ends.
+ */
+#include "bootstrap.h"
+#include "wifi_sta.h"
+#include "host_test.h"
+#include "esp_timer.h"
+#include "esp_netif.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief What a test step does and what happened to it
+ */
+typedef struct {
+    uint32_t sleep_ms;
+    esp_err_t result;
+    // Recorded
+    uint32_t calls;
+    uint32_t start_seq;
+    uint32_t end_seq;
+} step_ctx_t;
+
+static uint32_t s_seq = 0;
+static step_ctx_t s_nvs, s_netif, s_event_loop, s_wifi;
+static uint32_t s_nvs_erase = 0;
+static EventGroupHandle_t s_wifi_group = NULL;
+static SemaphoreHandle_t s_stuck_release = NULL;
+static bool s_stuck_done = false;
+
+static uint32_t next_seq (void)
+{
+    return __atomic_add_fetch (&s_seq, 1, __ATOMIC_SEQ_CST);
+}
+
+static esp_err_t record (step_ctx_t *ctx)
+{
+    ctx->start_seq = next_seq ();
+    ctx->calls++;
+    usleep (ctx->sleep_ms * 1000);
+    ctx->end_seq = next_seq ();
+    return ctx->result;
+}
+
+/******************************
+ * ESP-IDF stand-ins
+ */
+
+int64_t esp_timer_get_time(void)
+{
+    return (int64_t) (host_now_ns () / 1000);
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    // Full the first time: erased and initialized again
+    esp_err_t esp_ret = record (&s_nvs);
+    return s_nvs.calls == 1 ? ESP_ERR_NVS_NO_FREE_PAGES : esp_ret;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    s_nvs_erase++;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_init(void)
+{
+    return record (&s_netif);
+}
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    // Already created by the application: accepted
+    record (&s_event_loop);
+    return ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t wifi_sta_init(EventGroupHandle_t event_group)
+{
+    s_wifi_group = event_group;
+    return record (&s_wifi);
+}
+
+/******************************
+ * Tests
+ */
+
+static esp_err_t test_step (void *arg)
+{
+    return record ((step_ctx_t*) arg);
+}
+
+/**
+ * @brief Each step started after the steps it depends on ended
+ */
+static void check_order (const bootstrap_step_t *steps, uint8_t step_num)
+{
+    for (uint8_t i = 0; i < step_num; i++){
+        const step_ctx_t *ctx = (const step_ctx_t*) steps[i].arg;
+        for (uint8_t j = 0; j < i; j++){
+            if (steps[i].depends & BOOTSTRAP_DEP(j)){
+                HOST_CHECK (((const step_ctx_t*) steps[j].arg)->end_seq < ctx->start_seq);
+            }
+        }
+    }
+}
+
+static void test_invalid_args (void)
+{
+    step_ctx_t ctx = { 0 };
+    bootstrap_step_t steps[CONFIG_BOOTSTRAP_MAX_STEPS + 1];
+    for (int i = 0; i < CONFIG_BOOTSTRAP_MAX_STEPS + 1; i++){
+        steps[i] = (bootstrap_step_t) { .name = "step", .fn = test_step, .arg = &ctx };
+    }
+    HOST_CHECK (bootstrap_run (NULL, 1, NULL) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK (bootstrap_run (steps, 0, NULL) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK (bootstrap_run (steps, CONFIG_BOOTSTRAP_MAX_STEPS + 1, NULL) == ESP_ERR_INVALID_ARG);
+    // Dependencies on itself or a later step could deadlock
+    steps[1].depends = BOOTSTRAP_DEP(1);
+    HOST_CHECK (bootstrap_run (steps, 2, NULL) == ESP_ERR_INVALID_ARG);
+    steps[1].depends = BOOTSTRAP_DEP(2);
+    HOST_CHECK (bootstrap_run (steps, 3, NULL) == ESP_ERR_INVALID_ARG);
+    steps[1] = (bootstrap_step_t) { .name = "no_fn" };
+    HOST_CHECK (bootstrap_run (steps, 2, NULL) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK (ctx.calls == 0);
+}
+
+/**
+ * @brief WiFi station steps, then an application step depending on WiFi
+ */
+static void test_wifi_sta_steps (void)
+{
+    EventGroupHandle_t group = xEventGroupCreate();
+    step_ctx_t http = { 0 };
+    s_nvs.sleep_ms = 20;
+    s_netif.sleep_ms = 10;
+    s_event_loop.sleep_ms = 10;
+    const bootstrap_step_t steps[] = {
+        BOOTSTRAP_WIFI_STA_STEPS(group),
+        { .name = "http", .fn = test_step, .arg = &http, .depends = BOOTSTRAP_DEP(BOOTSTRAP_WIFI_STA) },
+    };
+    bootstrap_report_t report;
+    HOST_CHECK (bootstrap_run (steps, 5, &report) == ESP_OK);
+    HOST_CHECK (s_nvs.calls == 2 && s_nvs_erase == 1);
+    HOST_CHECK (s_wifi.calls == 1 && s_wifi_group == group);
+    HOST_CHECK (http.calls == 1);
+    // nvs, netif and event_loop in parallel, WiFi after all three, http last
+    HOST_CHECK (s_netif.start_seq < s_nvs.end_seq && s_event_loop.start_seq < s_nvs.end_seq);
+    HOST_CHECK (s_nvs.end_seq < s_wifi.start_seq && s_netif.end_seq < s_wifi.start_seq);
+    HOST_CHECK (s_event_loop.end_seq < s_wifi.start_seq && s_wifi.end_seq < http.start_seq);
+    HOST_CHECK (report.step_num == 5);
+    for (int i = 0; i < 5; i++){
+        HOST_CHECK (report.steps[i].result == ESP_OK);
+    }
+    vEventGroupDelete (group);
+}
+
+/**
+ * @brief Diamond a, b -> c, d -> e: the critical path is a, c, e
+ */
+static void test_critical_path (void)
+{
+    step_ctx_t ctx[5] = {
+        { .sleep_ms = 40 }, { .sleep_ms = 10 }, { .sleep_ms = 20 }, { .sleep_ms = 10 }, { .sleep_ms = 5 },
+    };
+    const bootstrap_step_t steps[] = {
+        { .name = "a", .fn = test_step, .arg = &ctx[0] },
+        { .name = "b", .fn = test_step, .arg = &ctx[1] },
+        { .name = "c", .fn = test_step, .arg = &ctx[2], .depends = BOOTSTRAP_DEP(0) },
+        { .name = "d", .fn = test_step, .arg = &ctx[3], .depends = BOOTSTRAP_DEP(1) },
+        { .name = "e", .fn = test_step, .arg = &ctx[4], .depends = BOOTSTRAP_DEP(2) | BOOTSTRAP_DEP(3) },
+    };
+    bootstrap_report_t report;
+    int64_t before_us = esp_timer_get_time();
+    HOST_CHECK (bootstrap_run (steps, 5, &report) == ESP_OK);
+    check_order (steps, 5);
+    // a and b overlap, so do c and d
+    HOST_CHECK (ctx[1].start_seq < ctx[0].end_seq && ctx[3].start_seq < ctx[2].end_seq);
+
+    HOST_CHECK (report.critical_steps == (BOOTSTRAP_DEP(0) | BOOTSTRAP_DEP(2) | BOOTSTRAP_DEP(4)));
+    uint32_t chain_us = 0;
+    for (int i = 0; i < 5; i += 2){
+        chain_us += report.steps[i].end_us - report.steps[i].start_us;
+    }
+    HOST_CHECK (report.critical_path_us == chain_us && chain_us >= 65000);
+    HOST_CHECK (report.total_us == report.steps[4].end_us && report.total_us >= report.critical_path_us);
+    HOST_CHECK (report.ready_us >= before_us + report.total_us);
+}
+
+/**
+ * @brief A failed step: its dependents and steps not started yet do not run,
+ * running ones finish, the first error is returned
+ */
+static void test_failure (void)
+{
+    step_ctx_t ctx[5] = {
+        { .sleep_ms = 20 },
+        { .sleep_ms = 5, .result = ESP_ERR_INVALID_STATE },    // Once the others started
+        { .sleep_ms = 40 },
+        { 0 },
+        { 0 },
+    };
+    const bootstrap_step_t steps[] = {
+        { .name = "a", .fn = test_step, .arg = &ctx[0] },
+        { .name = "fails", .fn = test_step, .arg = &ctx[1] },
+        { .name = "slow", .fn = test_step, .arg = &ctx[2] },
+        { .name = "after_fail", .fn = test_step, .arg = &ctx[3], .depends = BOOTSTRAP_DEP(1) },
+        { .name = "after_a", .fn = test_step, .arg = &ctx[4], .depends = BOOTSTRAP_DEP(0) },
+    };
+    bootstrap_report_t report;
+    HOST_CHECK (bootstrap_run (steps, 5, &report) == ESP_ERR_INVALID_STATE);
+    HOST_CHECK (ctx[0].calls == 1 && ctx[1].calls == 1 && ctx[2].calls == 1);
+    HOST_CHECK (ctx[3].calls == 0 && ctx[4].calls == 0);
+    HOST_CHECK (report.steps[0].result == ESP_OK && report.steps[1].result == ESP_ERR_INVALID_STATE);
+    // The slow step was waited for
+    HOST_CHECK (report.steps[2].result == ESP_OK && report.steps[2].end_us >= 40000);
+    HOST_CHECK (report.steps[3].result == ESP_ERR_NOT_FINISHED && report.steps[4].result == ESP_ERR_NOT_FINISHED);
+}
+
+static esp_err_t stuck_step (void *arg)
+{
+    xSemaphoreTake (s_stuck_release, portMAX_DELAY);
+    __atomic_store_n (&s_stuck_done, true, __ATOMIC_SEQ_CST);
+    // Logged with the step name after bootstrap_run returned
+    return ESP_FAIL;
+}
+
+/**
+ * @brief Steps on this stack frame, gone when the stuck step ends
+ */
+static esp_err_t run_stuck (bootstrap_report_t *report)
+{
+    step_ctx_t quick = { 0 }, never = { 0 };
+    const bootstrap_step_t steps[] = {
+        { .name = "quick", .fn = test_step, .arg = &quick },
+        { .name = "stuck", .fn = stuck_step },
+        { .name = "never", .fn = test_step, .arg = &never, .depends = BOOTSTRAP_DEP(1) },
+    };
+    esp_err_t esp_ret = bootstrap_run (steps, 3, report);
+    HOST_CHECK (quick.calls == 1 && never.calls == 0);
+    return esp_ret;
+}
+
+static void clobber_stack (void)
+{
+    volatile uint8_t junk[16 * 1024];
+    memset ((void*) junk, 0xA5, sizeof(junk));
+}
+
+static void test_timeout (void)
+{
+    s_stuck_release = xSemaphoreCreateBinary();
+    bootstrap_report_t report;
+    uint64_t start_ns = host_now_ns ();
+    HOST_CHECK (run_stuck (&report) == ESP_ERR_TIMEOUT);
+    uint64_t elapsed_ms = (host_now_ns () - start_ns) / 1000000;
+    HOST_CHECK (elapsed_ms >= CONFIG_BOOTSTRAP_TIMEOUT_MS && elapsed_ms < 2 * CONFIG_BOOTSTRAP_TIMEOUT_MS);
+    HOST_CHECK (report.steps[0].result == ESP_OK);
+    HOST_CHECK (report.steps[1].result == ESP_ERR_NOT_FINISHED && report.steps[2].result == ESP_ERR_NOT_FINISHED);
+    // Only finished steps count
+    HOST_CHECK (report.critical_path_us == report.steps[0].end_us - report.steps[0].start_us);
+
+    // The stuck step ends with the caller's array overwritten
+    clobber_stack ();
+    xSemaphoreGive (s_stuck_release);
+    for (int i = 0; i < 1000 && !__atomic_load_n (&s_stuck_done, __ATOMIC_SEQ_CST); i++){
+        usleep (1000);
+    }
+    HOST_CHECK (s_stuck_done);
+    usleep (50 * 1000);
+
+    // The runner is usable again
+    step_ctx_t ctx = { 0 };
+    const bootstrap_step_t steps[] = { { .name = "again", .fn = test_step, .arg = &ctx } };
+    HOST_CHECK (bootstrap_run (steps, 1, NULL) == ESP_OK && ctx.calls == 1);
+}
+
+int main (void)
+{
+    test_invalid_args();
+    test_wifi_sta_steps();
+    test_critical_path();
+    test_failure();
+    test_timeout();
+    return host_test_result();
+}
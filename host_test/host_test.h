@@ -0,0 +1,50 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * @brief Minimal check helpers shared by the host tests
+ * A failed check is reported and the test keeps running; main returns host_test_result().
+ */
+static int g_host_test_failures = 0;
+
+#define HOST_CHECK(cond)                                                            \
+    do {                                                                            \
+        if (!(cond)){                                                               \
+            fprintf (stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);\
+            g_host_test_failures++;                                                 \
+        }                                                                           \
+    } while (0)
+
+static inline int host_test_result (void)
+{
+    if (g_host_test_failures != 0){
+        fprintf (stderr, "%d check(s) failed\n", g_host_test_failures);
+        return 1;
+    }
+    printf ("PASS\n");
+    return 0;
+}
+
+static inline uint64_t host_now_ns (void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * @brief Deterministic pseudo random numbers (xorshift32), same sequence on every run
+ */
+static inline uint32_t host_rand (void)
+{
+    static uint32_t state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,4 @@
+#pragma once
+// Host build stand-in for the ESP-IDF header of the same name: no RTC memory on the host
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
@@ -0,0 +1,5 @@
+#pragma once
+// Host build stand-in for the ESP-IDF header of the same name
+#include "esp_err.h"
+
+esp_err_t esp_crt_bundle_attach(void *conf);
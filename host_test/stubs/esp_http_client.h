@@ -0,0 +1,49 @@
+#pragma once
+// Host build stand-in for the ESP-IDF header of the same name
+// Implemented in esp_http_client_host.c: plain HTTP/1.1 over POSIX sockets, no TLS,
+// Content-Length bodies only
+#include "esp_err.h"
+
+typedef struct esp_http_client *esp_http_client_handle_t;
+
+typedef enum {
+    HttpStatus_Ok = 200,
+    HttpStatus_MultipleChoices = 300,
+    HttpStatus_MovedPermanently = 301,
+    HttpStatus_Found = 302,
+    HttpStatus_SeeOther = 303,
+    HttpStatus_TemporaryRedirect = 307,
+    HttpStatus_PermanentRedirect = 308,
+    HttpStatus_BadRequest = 400,
+    HttpStatus_NotFound = 404,
+} HttpStatus_Code;
+
+typedef struct {
+    const char *url;
+    const char *cert_pem;
+    esp_err_t (*crt_bundle_attach)(void *conf);
+    int timeout_ms;
+    bool keep_alive_enable;
+} esp_http_client_config_t;
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config);
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value);
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len);
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client);
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len);
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client);
+
+esp_err_t esp_http_client_flush_response(esp_http_client_handle_t client, int *len);
+
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t client);
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client);
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
@@ -0,0 +1,329 @@
+/**
+ * @brief Host build stand-in for esp_http_client
+ * Plain HTTP/1.1 over POSIX sockets with the esp_http_client calling sequence:
+ * open sends the request, fetch_headers parses the response head, read returns
+ * the body (0 at its end or when the server closes, < 0 on socket errors).
+ * Like ESP-IDF, open does not follow redirects and the connection is kept
+ * between requests to the same host unless the server asks to close it.
+ */
+#define _GNU_SOURCE
+#include "esp_http_client.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define HOST_HTTP_MAX_HEADERS   4
+#define HOST_HTTP_HEAD_SIZE     2048
+
+struct esp_http_client {
+    char host[64];
+    char port[8];
+    char path[256];
+    char header_key[HOST_HTTP_MAX_HEADERS][32];
+    char header_value[HOST_HTTP_MAX_HEADERS][64];
+    int timeout_ms;
+    bool keep_alive;
+    int fd;
+    bool server_close;                  // Connection: close in the last response
+    // Response
+    int status;
+    int64_t content_length;             // -1: not given
+    int64_t body_read;
+    char location[256];
+    char head[HOST_HTTP_HEAD_SIZE];     // Response head, then body bytes read with it
+    size_t head_len;
+    size_t body_pos;                    // Body bytes in head[] start here
+};
+
+/**
+ * @brief Split http://host[:port]/path, a URL starting with / keeps the host
+ */
+static esp_err_t host_http_set_url (esp_http_client_handle_t client, const char *url)
+{
+    const char *path = url;
+    if (strncmp (url, "http://", 7) == 0){
+        const char *host = url + 7;
+        path = strchr (host, '/');
+        size_t host_len = path ? (size_t) (path - host) : strlen (host);
+        const char *colon = memchr (host, ':', host_len);
+        size_t name_len = colon ? (size_t) (colon - host) : host_len;
+        if (name_len == 0 || name_len >= sizeof(client->host)){
+            return ESP_ERR_INVALID_ARG;
+        }
+        char new_host[sizeof(client->host)];
+        char new_port[sizeof(client->port)] = "80";
+        memcpy (new_host, host, name_len);
+        new_host[name_len] = '\0';
+        if (colon != NULL){
+            size_t port_len = host_len - name_len - 1;
+            if (port_len == 0 || port_len >= sizeof(new_port)){
+                return ESP_ERR_INVALID_ARG;
+            }
+            memcpy (new_port, colon + 1, port_len);
+            new_port[port_len] = '\0';
+        }
+        // Another server: the open connection cannot be reused
+        if (strcmp (new_host, client->host) != 0 || strcmp (new_port, client->port) != 0){
+            esp_http_client_close (client);
+        }
+        strcpy (client->host, new_host);
+        strcpy (client->port, new_port);
+        if (path == NULL){
+            path = "/";
+        }
+    }
+    else if (url[0] != '/' || client->host[0] == '\0'){
+        // No TLS in the host build
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (strlen (path) >= sizeof(client->path)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    strcpy (client->path, path);
+    return ESP_OK;
+}
+
+static esp_err_t host_http_connect (esp_http_client_handle_t client)
+{
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *addr = NULL;
+    if (getaddrinfo (client->host, client->port, &hints, &addr) != 0){
+        return ESP_FAIL;
+    }
+    client->fd = socket (addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (client->fd < 0){
+        freeaddrinfo (addr);
+        return ESP_FAIL;
+    }
+    struct timeval timeout = { .tv_sec = client->timeout_ms / 1000, .tv_usec = (client->timeout_ms % 1000) * 1000 };
+    setsockopt (client->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt (client->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    int ret = connect (client->fd, addr->ai_addr, addr->ai_addrlen);
+    freeaddrinfo (addr);
+    if (ret != 0){
+        esp_http_client_close (client);
+        return ESP_FAIL;
+    }
+    client->server_close = false;
+    return ESP_OK;
+}
+
+static bool host_http_send (int fd, const char *data, size_t len)
+{
+    while (len > 0){
+        ssize_t sent = send (fd, data, len, MSG_NOSIGNAL);
+        if (sent <= 0){
+            return false;
+        }
+        data += sent;
+        len -= (size_t) sent;
+    }
+    return true;
+}
+
+static void host_http_parse_header (esp_http_client_handle_t client, char *line)
+{
+    char *value = strchr (line, ':');
+    if (value == NULL){
+        return;
+    }
+    *value++ = '\0';
+    while (*value == ' '){
+        value++;
+    }
+    if (strcasecmp (line, "Content-Length") == 0){
+        client->content_length = strtoll (value, NULL, 10);
+    }
+    else if (strcasecmp (line, "Location") == 0){
+        snprintf (client->location, sizeof(client->location), "%s", value);
+    }
+    else if (strcasecmp (line, "Connection") == 0 && strcasecmp (value, "close") == 0){
+        client->server_close = true;
+    }
+}
+
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    esp_http_client_handle_t client = calloc (1, sizeof(struct esp_http_client));
+    if (client == NULL){
+        return NULL;
+    }
+    client->fd = -1;
+    client->timeout_ms = config->timeout_ms;
+    client->keep_alive = config->keep_alive_enable;
+    if (host_http_set_url (client, config->url) != ESP_OK){
+        free (client);
+        return NULL;
+    }
+    return client;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    int free_slot = -1;
+    for (int i = 0; i < HOST_HTTP_MAX_HEADERS; i++){
+        if (strcasecmp (client->header_key[i], key) == 0){
+            free_slot = i;
+            break;
+        }
+        if (free_slot < 0 && client->header_key[i][0] == '\0'){
+            free_slot = i;
+        }
+    }
+    if (free_slot < 0){
+        return ESP_ERR_NO_MEM;
+    }
+    snprintf (client->header_key[free_slot], sizeof(client->header_key[0]), "%s", key);
+    snprintf (client->header_value[free_slot], sizeof(client->header_value[0]), "%s", value);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len)
+{
+    if (client->fd >= 0 && client->server_close){
+        esp_http_client_close (client);
+    }
+    if (client->fd < 0 && host_http_connect (client) != ESP_OK){
+        return ESP_FAIL;
+    }
+    char request[1024];
+    int len = snprintf (request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s:%s\r\nConnection: %s\r\n",
+                        client->path, client->host, client->port, client->keep_alive ? "keep-alive" : "close");
+    for (int i = 0; i < HOST_HTTP_MAX_HEADERS; i++){
+        if (client->header_key[i][0] != '\0'){
+            len += snprintf (request + len, sizeof(request) - len, "%s: %s\r\n",
+                             client->header_key[i], client->header_value[i]);
+        }
+    }
+    len += snprintf (request + len, sizeof(request) - len, "\r\n");
+    client->status = 0;
+    client->content_length = -1;
+    client->body_read = 0;
+    client->location[0] = '\0';
+    client->head_len = 0;
+    client->body_pos = 0;
+    if (!host_http_send (client->fd, request, (size_t) len)){
+        esp_http_client_close (client);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client)
+{
+    char *end = NULL;
+    while (end == NULL){
+        if (client->fd < 0 || client->head_len == sizeof(client->head) - 1){
+            return ESP_FAIL;
+        }
+        ssize_t len = recv (client->fd, client->head + client->head_len, sizeof(client->head) - 1 - client->head_len, 0);
+        if (len <= 0){
+            esp_http_client_close (client);
+            return ESP_FAIL;
+        }
+        client->head_len += (size_t) len;
+        client->head[client->head_len] = '\0';
+        end = strstr (client->head, "\r\n\r\n");
+    }
+    client->body_pos = (size_t) (end + 4 - client->head);
+    *end = '\0';
+    client->server_close = !client->keep_alive;
+    char *save = NULL;
+    char *line = strtok_r (client->head, "\r\n", &save);
+    if (line == NULL || sscanf (line, "HTTP/1.%*d %d", &client->status) != 1){
+        client->status = 0;
+        return ESP_FAIL;
+    }
+    while ((line = strtok_r (NULL, "\r\n", &save)) != NULL){
+        host_http_parse_header (client, line);
+    }
+    return client->content_length;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len)
+{
+    if (client->content_length >= 0 && client->body_read + len > client->content_length){
+        len = (int) (client->content_length - client->body_read);
+    }
+    if (len <= 0){
+        return 0;
+    }
+    // Body bytes received with the head first
+    if (client->body_pos < client->head_len){
+        size_t n = client->head_len - client->body_pos;
+        n = n < (size_t) len ? n : (size_t) len;
+        memcpy (buffer, client->head + client->body_pos, n);
+        client->body_pos += n;
+        client->body_read += (int64_t) n;
+        return (int) n;
+    }
+    if (client->fd < 0){
+        return 0;
+    }
+    ssize_t ret = recv (client->fd, buffer, (size_t) len, 0);
+    if (ret < 0){
+        esp_http_client_close (client);
+        return -1;
+    }
+    if (ret == 0){
+        esp_http_client_close (client);
+        return 0;
+    }
+    client->body_read += ret;
+    return (int) ret;
+}
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client)
+{
+    return client->content_length >= 0 && client->body_read == client->content_length;
+}
+
+esp_err_t esp_http_client_flush_response(esp_http_client_handle_t client, int *len)
+{
+    char buffer[256];
+    int total = 0;
+    int ret;
+    while ((ret = esp_http_client_read (client, buffer, sizeof(buffer))) > 0){
+        total += ret;
+    }
+    if (len != NULL){
+        *len = total;
+    }
+    return ret < 0 ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t client)
+{
+    if (client->location[0] == '\0'){
+        return ESP_ERR_INVALID_ARG;
+    }
+    return host_http_set_url (client, client->location);
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    if (client->fd >= 0){
+        close (client->fd);
+        client->fd = -1;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    esp_http_client_close (client);
+    free (client);
+    return ESP_OK;
+}
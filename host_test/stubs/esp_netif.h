@@ -0,0 +1,6 @@
+#pragma once
+// Host build stand-in for the ESP-IDF header of the same name
+#include "esp_err.h"
+#include "esp_wifi_netif.h"
+
+esp_err_t esp_netif_init(void);
@@ -0,0 +1,5 @@
+#pragma once
+// Host build stand-in for the ESP-IDF header of the same name
+#include <stddef.h>
+
+void esp_fill_random(void *buf, size_t len);
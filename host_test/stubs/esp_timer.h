@@ -0,0 +1,6 @@
+#pragma once
+// Host build stand-in for the ESP-IDF header of the same name
+// Implemented by the tests that use it, so they control the time
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,44 @@
+#pragma once
+// Host build stand-in for the ESP-IDF header of the same name
+#include "esp_err.h"
+#include "esp_event.h"
+
+typedef enum {
+    WIFI_AUTH_OPEN = 0,
+    WIFI_AUTH_WEP,
+    WIFI_AUTH_WPA_PSK,
+    WIFI_AUTH_WPA2_PSK,
+    WIFI_AUTH_WPA_WPA2_PSK,
+    WIFI_AUTH_ENTERPRISE,
+    WIFI_AUTH_WPA3_PSK,
+    WIFI_AUTH_WPA2_WPA3_PSK,
+    WIFI_AUTH_MAX
+} wifi_auth_mode_t;
+
+/**
+ * @brief Same leading fields as ESP-IDF v5, the rest is padded to a similar size
+ */
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t ssid[33];
+    uint8_t primary;
+    int second;
+    int8_t rssi;
+    wifi_auth_mode_t authmode;
+    int pairwise_cipher;
+    int group_cipher;
+    int ant;
+    uint32_t phy_flags;
+    uint8_t country[12];
+    uint32_t he_ap;
+} wifi_ap_record_t;
+
+extern esp_event_base_t const WIFI_EVENT;
+
+typedef enum {
+    WIFI_EVENT_SCAN_DONE = 1,
+    WIFI_EVENT_STA_START,
+    WIFI_EVENT_STA_STOP,
+    WIFI_EVENT_STA_CONNECTED,
+    WIFI_EVENT_STA_DISCONNECTED,
+} wifi_event_t;
@@ -0,0 +1,9 @@
+#pragma once
+// Host build stand-in for the ESP-IDF header of the same name
+#include <stdint.h>
+
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef struct {
+    uint32_t addr;
+} esp_ip4_addr_t;
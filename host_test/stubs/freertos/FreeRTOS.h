@@ -0,0 +1,54 @@
+#pragma once
+// Host build stand-in: FreeRTOS types and macros, the runtime is freertos_host.c (pthreads)
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdFAIL                  0
+#define pdPASS                  1
+#define portMAX_DELAY           ((TickType_t) 0xFFFFFFFFu)
+#define configTICK_RATE_HZ      1000
+#define portTICK_PERIOD_MS      (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)       ((TickType_t) (ms))
+#define tskNO_AFFINITY          0x7FFFFFFF
+
+#define BIT0    (1UL << 0)
+#define BIT1    (1UL << 1)
+#define BIT2    (1UL << 2)
+#define BIT3    (1UL << 3)
+#define BIT4    (1UL << 4)
+#define BIT5    (1UL << 5)
+#define BIT6    (1UL << 6)
+#define BIT7    (1UL << 7)
+#define BIT10   (1UL << 10)
+#define BIT11   (1UL << 11)
+#define BIT12   (1UL << 12)
+#define BIT20   (1UL << 20)
+#define BIT21   (1UL << 21)
+#define BIT23   (1UL << 23)
+#define BIT30   (1UL << 30)
+
+/**
+ * @brief Critical sections: one global recursive lock on the host
+ */
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    0
+
+void host_critical_enter(void);
+void host_critical_exit(void);
+
+#define portENTER_CRITICAL(mux)         do { (void) (mux); host_critical_enter(); } while (0)
+#define portEXIT_CRITICAL(mux)          do { (void) (mux); host_critical_exit(); } while (0)
+#define portENTER_CRITICAL_SAFE(mux)    portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_SAFE(mux)     portEXIT_CRITICAL(mux)
+
+// Single core on the host
+static inline BaseType_t xPortGetCoreID(void)
+{
+    return 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+// Host build stand-in for the FreeRTOS header of the same name: semaphores are queues of empty items
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+#define xSemaphoreCreateBinary()            xSemaphoreCreateCounting (1, 0)
+#define vSemaphoreDelete(sem)               vQueueDelete (sem)
+#define xSemaphoreTake(sem, ticks)          xQueueReceive (sem, NULL, ticks)
+#define xSemaphoreGive(sem)                 xQueueSend (sem, NULL, 0)
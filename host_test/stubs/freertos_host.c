@@ -0,0 +1,320 @@
+/**
+ * @brief Host build stand-in for the FreeRTOS runtime used by the components
+ * Tasks are detached threads, queues, event groups and notifications are a mutex
+ * and a condition variable each. Ticks are milliseconds. No priorities or cores.
+ */
+#define _GNU_SOURCE
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+struct host_task {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify;
+    TaskFunction_t fn;
+    void *arg;
+};
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t *items;
+    size_t item_size;
+    size_t length;
+    size_t head;
+    size_t count;
+};
+
+struct host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+};
+
+static pthread_mutex_t s_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread struct host_task *t_current = NULL;
+
+/**
+ * @brief Wait on cond until the deadline, false on timeout
+ */
+static bool host_wait (pthread_cond_t *cond, pthread_mutex_t *lock, const struct timespec *deadline)
+{
+    if (deadline == NULL){
+        pthread_cond_wait (cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait (cond, lock, deadline) != ETIMEDOUT;
+}
+
+/**
+ * @brief Absolute deadline for pthread_cond_timedwait, NULL for portMAX_DELAY
+ */
+static struct timespec *host_deadline (TickType_t ticks, struct timespec *deadline)
+{
+    if (ticks == portMAX_DELAY){
+        return NULL;
+    }
+    clock_gettime (CLOCK_REALTIME, deadline);
+    uint64_t ns = (uint64_t) deadline->tv_nsec + (uint64_t) ticks * 1000000ULL;
+    deadline->tv_sec += (time_t) (ns / 1000000000ULL);
+    deadline->tv_nsec = (long) (ns % 1000000000ULL);
+    return deadline;
+}
+
+static struct host_task *host_task_new (void)
+{
+    struct host_task *task = calloc (1, sizeof(*task));
+    if (task != NULL){
+        pthread_mutex_init (&task->lock, NULL);
+        pthread_cond_init (&task->cond, NULL);
+    }
+    return task;
+}
+
+static void *host_task_entry (void *arg)
+{
+    t_current = (struct host_task*) arg;
+    t_current->fn (t_current->arg);
+    vTaskDelete (NULL);
+    return NULL;
+}
+
+void host_critical_enter(void)
+{
+    pthread_mutex_lock (&s_critical);
+}
+
+void host_critical_exit(void)
+{
+    pthread_mutex_unlock (&s_critical);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_size, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    struct host_task *task = host_task_new();
+    if (task == NULL){
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    pthread_t thread;
+    if (pthread_create (&thread, NULL, host_task_entry, task) != 0){
+        free (task);
+        return pdFAIL;
+    }
+    pthread_detach (thread);
+    if (handle != NULL){
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // Only self deletion is used; the handle stays valid for late notifications
+    if (task == NULL || task == t_current){
+        pthread_exit (NULL);
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec delay = { .tv_sec = ticks / 1000, .tv_nsec = (long) (ticks % 1000) * 1000000L };
+    nanosleep (&delay, NULL);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (TickType_t) ((uint64_t) now.tv_sec * 1000 + (uint64_t) now.tv_nsec / 1000000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (t_current == NULL){
+        // Main thread or a thread not created by xTaskCreate
+        t_current = host_task_new();
+    }
+    return t_current;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock (&task->lock);
+    task->notify++;
+    pthread_cond_broadcast (&task->cond);
+    pthread_mutex_unlock (&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct host_task *task = xTaskGetCurrentTaskHandle();
+    struct timespec deadline;
+    struct timespec *until = host_deadline (ticks, &deadline);
+    pthread_mutex_lock (&task->lock);
+    while (task->notify == 0 && host_wait (&task->cond, &task->lock, until)){
+    }
+    uint32_t value = task->notify;
+    if (value != 0){
+        task->notify = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock (&task->lock);
+    return value;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct host_queue *queue = calloc (1, sizeof(*queue));
+    if (queue == NULL){
+        return NULL;
+    }
+    queue->items = calloc (length, item_size ? item_size : 1);
+    if (queue->items == NULL){
+        free (queue);
+        return NULL;
+    }
+    queue->item_size = item_size;
+    queue->length = length;
+    pthread_mutex_init (&queue->lock, NULL);
+    pthread_cond_init (&queue->cond, NULL);
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    pthread_mutex_destroy (&queue->lock);
+    pthread_cond_destroy (&queue->cond);
+    free (queue->items);
+    free (queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    struct timespec deadline;
+    struct timespec *until = host_deadline (ticks, &deadline);
+    pthread_mutex_lock (&queue->lock);
+    while (queue->count == queue->length){
+        if (ticks == 0 || !host_wait (&queue->cond, &queue->lock, until)){
+            pthread_mutex_unlock (&queue->lock);
+            return pdFAIL;
+        }
+    }
+    size_t tail = (queue->head + queue->count) % queue->length;
+    if (queue->item_size != 0 && item != NULL){
+        memcpy (queue->items + tail * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    pthread_cond_broadcast (&queue->cond);
+    pthread_mutex_unlock (&queue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    struct timespec deadline;
+    struct timespec *until = host_deadline (ticks, &deadline);
+    pthread_mutex_lock (&queue->lock);
+    while (queue->count == 0){
+        if (ticks == 0 || !host_wait (&queue->cond, &queue->lock, until)){
+            pthread_mutex_unlock (&queue->lock);
+            return pdFAIL;
+        }
+    }
+    if (queue->item_size != 0 && item != NULL){
+        memcpy (item, queue->items + queue->head * queue->item_size, queue->item_size);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_broadcast (&queue->cond);
+    pthread_mutex_unlock (&queue->lock);
+    return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    SemaphoreHandle_t sem = xQueueCreate (max_count, 0);
+    for (UBaseType_t i = 0; sem != NULL && i < initial_count; i++){
+        xQueueSend (sem, NULL, 0);
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateCounting (1, 1);
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    struct host_event_group *group = calloc (1, sizeof(*group));
+    if (group != NULL){
+        pthread_mutex_init (&group->lock, NULL);
+        pthread_cond_init (&group->cond, NULL);
+    }
+    return group;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+    pthread_mutex_destroy (&group->lock);
+    pthread_cond_destroy (&group->cond);
+    free (group);
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    pthread_mutex_lock (&group->lock);
+    EventBits_t bits = group->bits;
+    pthread_mutex_unlock (&group->lock);
+    return bits;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock (&group->lock);
+    group->bits |= bits;
+    EventBits_t result = group->bits;
+    pthread_cond_broadcast (&group->cond);
+    pthread_mutex_unlock (&group->lock);
+    return result;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock (&group->lock);
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    pthread_mutex_unlock (&group->lock);
+    return previous;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks)
+{
+    struct timespec deadline;
+    struct timespec *until = host_deadline (ticks, &deadline);
+    pthread_mutex_lock (&group->lock);
+    bool done;
+    while (!(done = wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0)){
+        if (ticks == 0 || !host_wait (&group->cond, &group->lock, until)){
+            break;
+        }
+    }
+    EventBits_t result = group->bits;
+    if (done && clear_on_exit){
+        group->bits &= ~bits;
+    }
+    pthread_mutex_unlock (&group->lock);
+    return result;
+}
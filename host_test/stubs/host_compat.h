@@ -0,0 +1,16 @@
+#pragma once
+// newlib functions used by the components that glibc lacks (forced include, -include host_compat.h)
+#include <string.h>
+
+#if !defined(__GLIBC__) || __GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38)
+static inline size_t strlcpy (char *dst, const char *src, size_t size)
+{
+    size_t len = strlen (src);
+    if (size != 0){
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy (dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
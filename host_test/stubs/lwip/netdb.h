@@ -0,0 +1,3 @@
+#pragma once
+// Host build stand-in for the lwIP header of the same name
+#include <netdb.h>
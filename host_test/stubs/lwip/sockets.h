@@ -0,0 +1,8 @@
+#pragma once
+// Host build stand-in for the lwIP header of the same name
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
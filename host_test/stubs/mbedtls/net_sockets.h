@@ -0,0 +1,19 @@
+#pragma once
+// Host build stand-in for the mbedtls 3 header of the same name
+// Implemented in mbedtls_ssl_host.c on POSIX sockets
+#include <stdint.h>
+#include <stddef.h>
+
+#define MBEDTLS_ERR_NET_SEND_FAILED     -0x004E
+#define MBEDTLS_ERR_NET_RECV_FAILED     -0x004C
+#define MBEDTLS_ERR_NET_CONN_RESET      -0x0050
+
+typedef struct {
+    int fd;
+} mbedtls_net_context;
+
+void mbedtls_net_init(mbedtls_net_context *ctx);
+int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len);
+int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len);
+int mbedtls_net_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout);
+void mbedtls_net_free(mbedtls_net_context *ctx);
@@ -0,0 +1,82 @@
+#pragma once
+// Host build stand-in for the mbedtls 3 header of the same name
+// Implemented in mbedtls_ssl_host.c over OpenSSL: real TLS 1.2 and 1.3 on the socket of
+// the net context. Sessions follow mbedtls 3.6: one export per handshake (TLS 1.2) or per
+// ticket (TLS 1.3), and TLS 1.3 tickets are dropped unless the client asks to be signaled.
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/x509_crt.h"
+
+#define MBEDTLS_SSL_SESSION_TICKETS
+#define MBEDTLS_SSL_PROTO_TLS1_2
+#define MBEDTLS_SSL_PROTO_TLS1_3
+
+#define MBEDTLS_SSL_IS_CLIENT                       0
+#define MBEDTLS_SSL_TRANSPORT_STREAM                0
+#define MBEDTLS_SSL_PRESET_DEFAULT                  0
+#define MBEDTLS_SSL_VERIFY_REQUIRED                 2
+#define MBEDTLS_SSL_SESSION_TICKETS_ENABLED         1
+#define MBEDTLS_SSL_TLS1_3_SIGNAL_NEW_SESSION_TICKETS_DISABLED  0
+#define MBEDTLS_SSL_TLS1_3_SIGNAL_NEW_SESSION_TICKETS_ENABLED   1
+
+#define MBEDTLS_ERR_SSL_WANT_READ                   -0x6900
+#define MBEDTLS_ERR_SSL_WANT_WRITE                  -0x6880
+#define MBEDTLS_ERR_SSL_TIMEOUT                     -0x6800
+#define MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY           -0x7880
+#define MBEDTLS_ERR_SSL_CONN_EOF                    -0x7280
+#define MBEDTLS_ERR_SSL_ALLOC_FAILED                -0x7F00
+#define MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL            -0x6A00
+#define MBEDTLS_ERR_SSL_BAD_INPUT_DATA              -0x7100
+#define MBEDTLS_ERR_SSL_HANDSHAKE_FAILURE           -0x6E00
+#define MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET -0x7B00
+
+typedef int mbedtls_ssl_send_t(void *ctx, const unsigned char *buf, size_t len);
+typedef int mbedtls_ssl_recv_t(void *ctx, unsigned char *buf, size_t len);
+typedef int mbedtls_ssl_recv_timeout_t(void *ctx, unsigned char *buf, size_t len, uint32_t timeout);
+
+typedef struct {
+    void *session;              // SSL_SESSION, NULL: none
+} mbedtls_ssl_session;
+
+typedef struct {
+    void *ctx;                  // SSL_CTX
+    uint32_t read_timeout;
+    int signal_tickets;
+} mbedtls_ssl_config;
+
+typedef struct {
+    const mbedtls_ssl_config *conf;
+    void *ssl;                  // SSL
+    void *session;              // Latest SSL_SESSION of the connection
+    bool exportable;            // mbedtls_ssl_get_session allowed
+    bool ticket;                // TLS 1.3 ticket received, not signaled yet
+} mbedtls_ssl_context;
+
+void mbedtls_ssl_init(mbedtls_ssl_context *ssl);
+void mbedtls_ssl_free(mbedtls_ssl_context *ssl);
+void mbedtls_ssl_config_init(mbedtls_ssl_config *conf);
+void mbedtls_ssl_config_free(mbedtls_ssl_config *conf);
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config *conf, int endpoint, int transport, int preset);
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config *conf, mbedtls_x509_crt *ca_chain, void *ca_crl);
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config *conf, int authmode);
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config *conf, int (*f_rng)(void *, unsigned char *, size_t), void *p_rng);
+void mbedtls_ssl_conf_read_timeout(mbedtls_ssl_config *conf, uint32_t timeout);
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config *conf, int use_tickets);
+void mbedtls_ssl_conf_tls13_enable_signal_new_session_tickets(mbedtls_ssl_config *conf, int signal_new_session_tickets);
+int mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf);
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context *ssl, const char *hostname);
+void mbedtls_ssl_set_bio(mbedtls_ssl_context *ssl, void *p_bio, mbedtls_ssl_send_t *f_send,
+                         mbedtls_ssl_recv_t *f_recv, mbedtls_ssl_recv_timeout_t *f_recv_timeout);
+int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl);
+int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len);
+int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len);
+int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl);
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session *session);
+void mbedtls_ssl_session_free(mbedtls_ssl_session *session);
+int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl, mbedtls_ssl_session *session);
+int mbedtls_ssl_set_session(mbedtls_ssl_context *ssl, const mbedtls_ssl_session *session);
+int mbedtls_ssl_session_save(const mbedtls_ssl_session *session, unsigned char *buf, size_t buf_len, size_t *olen);
+int mbedtls_ssl_session_load(mbedtls_ssl_session *session, const unsigned char *buf, size_t len);
@@ -0,0 +1,15 @@
+#pragma once
+// Host build stand-in for the mbedtls 3 header of the same name
+// Implemented in mbedtls_ssl_host.c: PEM certificates parsed by OpenSSL
+#include <stddef.h>
+
+#define MBEDTLS_ERR_X509_INVALID_FORMAT     -0x2180
+#define MBEDTLS_ERR_X509_CERT_VERIFY_FAILED -0x2700
+
+typedef struct {
+    void *certs;        // STACK_OF(X509)
+} mbedtls_x509_crt;
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt *crt);
+int mbedtls_x509_crt_parse(mbedtls_x509_crt *chain, const unsigned char *buf, size_t len);
+void mbedtls_x509_crt_free(mbedtls_x509_crt *crt);
@@ -0,0 +1,372 @@
+/**
+ * @brief Host build stand-in for the mbedtls 3 TLS client API, over OpenSSL
+ * The TLS is real: OpenSSL runs the handshake and records on the socket of the
+ * net context, so the components talk to an actual TLS server on loopback.
+ * What mbedtls 3.6 does differently is reproduced where the components depend on it:
+ * - mbedtls_ssl_get_session works once per handshake (TLS 1.2) or per ticket (TLS 1.3)
+ * - TLS 1.3 tickets are dropped unless signaling is enabled, then mbedtls_ssl_read
+ *   returns MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET once per ticket
+ * - mbedtls_ssl_read waits up to the configured read timeout
+ * - a session can be offered again after a TLS 1.3 resumption
+ * The RNG given with mbedtls_ssl_conf_rng is not used.
+ */
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/x509_crt.h"
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/**
+ * @brief Session handed over by OpenSSL: TLS 1.3 tickets only, TLS 1.2 sessions
+ * are taken after the handshake
+ */
+static int host_ssl_new_session (SSL *s, SSL_SESSION *session)
+{
+    mbedtls_ssl_context *ssl = SSL_get_app_data (s);
+    if (ssl == NULL || SSL_version (s) != TLS1_3_VERSION || !ssl->conf->signal_tickets){
+        return 0;
+    }
+    if (ssl->session != NULL){
+        SSL_SESSION_free (ssl->session);
+    }
+    ssl->session = session;
+    ssl->exportable = true;
+    ssl->ticket = true;
+    return 1;
+}
+
+static int host_ssl_io_error (SSL *s, int ret, int would_block)
+{
+    int error = SSL_get_error (s, ret);
+    int reason = ERR_GET_REASON (ERR_peek_error ());
+    ERR_clear_error ();
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE){
+        return would_block;
+    }
+    if (error == SSL_ERROR_ZERO_RETURN){
+        return MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY;
+    }
+    if (reason == SSL_R_UNEXPECTED_EOF_WHILE_READING || (error == SSL_ERROR_SYSCALL && ret == 0)){
+        return MBEDTLS_ERR_SSL_CONN_EOF;
+    }
+    return (errno == ECONNRESET || errno == EPIPE) ? MBEDTLS_ERR_NET_CONN_RESET : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+
+void mbedtls_net_init(mbedtls_net_context *ctx)
+{
+    ctx->fd = -1;
+}
+
+int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    ssize_t ret = send (((mbedtls_net_context*) ctx)->fd, buf, len, MSG_NOSIGNAL);
+    if (ret < 0){
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+    }
+    return (int) ret;
+}
+
+int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    ssize_t ret = recv (((mbedtls_net_context*) ctx)->fd, buf, len, 0);
+    if (ret < 0){
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_RECV_FAILED;
+    }
+    return (int) ret;
+}
+
+int mbedtls_net_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout)
+{
+    struct pollfd pfd = { .fd = ((mbedtls_net_context*) ctx)->fd, .events = POLLIN };
+    if (poll (&pfd, 1, timeout == 0 ? -1 : (int) timeout) == 0){
+        return MBEDTLS_ERR_SSL_TIMEOUT;
+    }
+    return mbedtls_net_recv (ctx, buf, len);
+}
+
+void mbedtls_net_free(mbedtls_net_context *ctx)
+{
+    if (ctx->fd >= 0){
+        close (ctx->fd);
+    }
+    ctx->fd = -1;
+}
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt *crt)
+{
+    crt->certs = NULL;
+}
+
+int mbedtls_x509_crt_parse(mbedtls_x509_crt *chain, const unsigned char *buf, size_t len)
+{
+    if (chain->certs == NULL){
+        chain->certs = sk_X509_new_null ();
+    }
+    // mbedtls wants the terminating NUL of PEM data in len
+    BIO *bio = BIO_new_mem_buf (buf, (int) strnlen ((const char*) buf, len));
+    int parsed = 0;
+    X509 *cert;
+    while (bio != NULL && (cert = PEM_read_bio_X509 (bio, NULL, NULL, NULL)) != NULL){
+        sk_X509_push ((STACK_OF(X509)*) chain->certs, cert);
+        parsed++;
+    }
+    BIO_free (bio);
+    ERR_clear_error ();
+    return parsed > 0 ? 0 : MBEDTLS_ERR_X509_INVALID_FORMAT;
+}
+
+void mbedtls_x509_crt_free(mbedtls_x509_crt *crt)
+{
+    if (crt->certs != NULL){
+        sk_X509_pop_free ((STACK_OF(X509)*) crt->certs, X509_free);
+    }
+    crt->certs = NULL;
+}
+
+void mbedtls_ssl_init(mbedtls_ssl_context *ssl)
+{
+    memset (ssl, 0, sizeof(*ssl));
+}
+
+void mbedtls_ssl_free(mbedtls_ssl_context *ssl)
+{
+    if (ssl->ssl != NULL){
+        SSL_free (ssl->ssl);
+    }
+    if (ssl->session != NULL){
+        SSL_SESSION_free (ssl->session);
+    }
+    memset (ssl, 0, sizeof(*ssl));
+}
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config *conf)
+{
+    memset (conf, 0, sizeof(*conf));
+}
+
+void mbedtls_ssl_config_free(mbedtls_ssl_config *conf)
+{
+    if (conf->ctx != NULL){
+        SSL_CTX_free (conf->ctx);
+    }
+    memset (conf, 0, sizeof(*conf));
+}
+
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config *conf, int endpoint, int transport, int preset)
+{
+    SSL_CTX *ctx = SSL_CTX_new (TLS_client_method ());
+    if (ctx == NULL){
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    SSL_CTX_set_min_proto_version (ctx, TLS1_2_VERSION);
+    SSL_CTX_set_session_cache_mode (ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb (ctx, host_ssl_new_session);
+    // SSL_read returns after each record without application data, like mbedtls
+    SSL_CTX_clear_mode (ctx, SSL_MODE_AUTO_RETRY);
+    conf->ctx = ctx;
+    return 0;
+}
+
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config *conf, mbedtls_x509_crt *ca_chain, void *ca_crl)
+{
+    X509_STORE *store = SSL_CTX_get_cert_store (conf->ctx);
+    STACK_OF(X509) *certs = ca_chain->certs;
+    for (int i = 0; certs != NULL && i < sk_X509_num (certs); i++){
+        X509_STORE_add_cert (store, sk_X509_value (certs, i));
+    }
+}
+
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config *conf, int authmode)
+{
+    SSL_CTX_set_verify (conf->ctx, authmode == MBEDTLS_SSL_VERIFY_REQUIRED ? SSL_VERIFY_PEER : SSL_VERIFY_NONE, NULL);
+}
+
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config *conf, int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+}
+
+void mbedtls_ssl_conf_read_timeout(mbedtls_ssl_config *conf, uint32_t timeout)
+{
+    conf->read_timeout = timeout;
+}
+
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config *conf, int use_tickets)
+{
+    if (!use_tickets){
+        SSL_CTX_set_options (conf->ctx, SSL_OP_NO_TICKET);
+    }
+}
+
+void mbedtls_ssl_conf_tls13_enable_signal_new_session_tickets(mbedtls_ssl_config *conf, int signal_new_session_tickets)
+{
+    conf->signal_tickets = signal_new_session_tickets;
+}
+
+int mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf)
+{
+    ssl->conf = conf;
+    ssl->ssl = SSL_new (conf->ctx);
+    if (ssl->ssl == NULL){
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    SSL_set_app_data (ssl->ssl, ssl);
+    return 0;
+}
+
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context *ssl, const char *hostname)
+{
+    // SNI and certificate name check
+    if (SSL_set_tlsext_host_name (ssl->ssl, hostname) != 1 || SSL_set1_host (ssl->ssl, hostname) != 1){
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    return 0;
+}
+
+void mbedtls_ssl_set_bio(mbedtls_ssl_context *ssl, void *p_bio, mbedtls_ssl_send_t *f_send,
+                         mbedtls_ssl_recv_t *f_recv, mbedtls_ssl_recv_timeout_t *f_recv_timeout)
+{
+    // OpenSSL reads the socket itself, the callbacks are the mbedtls_net ones
+    int fd = ((mbedtls_net_context*) p_bio)->fd;
+    SSL_set_fd (ssl->ssl, fd);
+    uint32_t timeout_ms = ssl->conf->read_timeout;
+    if (timeout_ms != 0){
+        struct timeval timeout = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+        setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt (fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+}
+
+int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl)
+{
+    ERR_clear_error ();
+    int ret = SSL_connect (ssl->ssl);
+    if (ret != 1){
+        if (SSL_get_verify_result (ssl->ssl) != X509_V_OK){
+            ERR_clear_error ();
+            return MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+        }
+        // Blocking socket: would block means the read timeout expired
+        ret = host_ssl_io_error (ssl->ssl, ret, MBEDTLS_ERR_SSL_TIMEOUT);
+        return (ret == MBEDTLS_ERR_SSL_TIMEOUT) ? ret : MBEDTLS_ERR_SSL_HANDSHAKE_FAILURE;
+    }
+    // TLS 1.3 has nothing to export until a ticket arrives
+    if (SSL_version (ssl->ssl) != TLS1_3_VERSION){
+        ssl->session = SSL_get1_session (ssl->ssl);
+        ssl->exportable = (ssl->session != NULL);
+    }
+    return 0;
+}
+
+int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
+{
+    while (1){
+        if (!SSL_has_pending (ssl->ssl)){
+            struct pollfd pfd = { .fd = SSL_get_fd (ssl->ssl), .events = POLLIN };
+            uint32_t timeout_ms = ssl->conf->read_timeout;
+            if (poll (&pfd, 1, timeout_ms == 0 ? -1 : (int) timeout_ms) == 0){
+                return MBEDTLS_ERR_SSL_TIMEOUT;
+            }
+        }
+        ERR_clear_error ();
+        int ret = SSL_read (ssl->ssl, buf, (int) len);
+        if (ret > 0){
+            return ret;
+        }
+        ret = host_ssl_io_error (ssl->ssl, ret, MBEDTLS_ERR_SSL_WANT_READ);
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ){
+            return ret;
+        }
+        // A record without application data was processed
+        if (ssl->ticket){
+            ssl->ticket = false;
+            return MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET;
+        }
+    }
+}
+
+int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len)
+{
+    ERR_clear_error ();
+    int ret = SSL_write (ssl->ssl, buf, (int) len);
+    if (ret > 0){
+        return ret;
+    }
+    ret = host_ssl_io_error (ssl->ssl, ret, MBEDTLS_ERR_SSL_WANT_WRITE);
+    return (ret == MBEDTLS_ERR_SSL_WANT_WRITE) ? ret : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl)
+{
+    ERR_clear_error ();
+    SSL_shutdown (ssl->ssl);
+    ERR_clear_error ();
+    return 0;
+}
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session *session)
+{
+    session->session = NULL;
+}
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session *session)
+{
+    if (session->session != NULL){
+        SSL_SESSION_free (session->session);
+    }
+    session->session = NULL;
+}
+
+int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl, mbedtls_ssl_session *session)
+{
+    if (!ssl->exportable || ssl->session == NULL){
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    // A copy, like mbedtls: OpenSSL marks the session of a connection freed without
+    // close notify as not resumable
+    mbedtls_ssl_session_free (session);
+    session->session = SSL_SESSION_dup (ssl->session);
+    if (session->session == NULL){
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    ((mbedtls_ssl_context*) ssl)->exportable = false;
+    return 0;
+}
+
+int mbedtls_ssl_set_session(mbedtls_ssl_context *ssl, const mbedtls_ssl_session *session)
+{
+    // OpenSSL marks an offered TLS 1.3 session used up, mbedtls keeps it: offer a copy
+    SSL_SESSION *copy = session->session != NULL ? SSL_SESSION_dup (session->session) : NULL;
+    int ret = (copy != NULL) ? SSL_set_session (ssl->ssl, copy) : 0;
+    SSL_SESSION_free (copy);
+    return (ret == 1) ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
+
+int mbedtls_ssl_session_save(const mbedtls_ssl_session *session, unsigned char *buf, size_t buf_len, size_t *olen)
+{
+    int len = session->session != NULL ? i2d_SSL_SESSION (session->session, NULL) : 0;
+    if (len <= 0){
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    *olen = (size_t) len;
+    if (buf_len < (size_t) len){
+        return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+    }
+    i2d_SSL_SESSION (session->session, &buf);
+    return 0;
+}
+
+int mbedtls_ssl_session_load(mbedtls_ssl_session *session, const unsigned char *buf, size_t len)
+{
+    mbedtls_ssl_session_free (session);
+    session->session = d2i_SSL_SESSION (NULL, &buf, (long) len);
+    return session->session != NULL ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
@@ -0,0 +1,41 @@
+#pragma once
+// Host build configuration (menuconfig defaults)
+// The trace test builds once per level with -DCONFIG_WIFI_STA_TRACE_LEVEL=n
+#ifndef CONFIG_WIFI_STA_TRACE_LEVEL
+#define CONFIG_WIFI_STA_TRACE_LEVEL                 0
+#endif
+#define CONFIG_WIFI_STA_TRACE_BUF_RECORDS           32
+#define CONFIG_WIFI_STA_TRACE_PARTITION_LABEL       "trace"
+#define CONFIG_WIFI_STA_HTTP_CHUNK_SIZE             512
+#define CONFIG_WIFI_STA_SCAN_SCHED_MIN_MS           5000
+#define CONFIG_WIFI_STA_SCAN_SCHED_MAX_MS           600000
+#define CONFIG_WIFI_STA_SCAN_SCHED_CHURN_LOW        10
+#define CONFIG_WIFI_STA_SCAN_SCHED_CHURN_HIGH       30
+#define CONFIG_WIFI_STA_SCAN_SCHED_RSSI_FLOOR       -85
+#define CONFIG_WIFI_STA_SCAN_SCHED_RSSI_VARIANCE_FULL 64
+// Smaller than menuconfig so the tests overflow them
+#define CONFIG_WIFI_STA_SCAN_SCHED_MAX_AP           16
+#define CONFIG_WIFI_STA_SCAN_SCHED_HISTORY          8
+#define CONFIG_WIFI_OTA_BUFFER_SIZE                 4096
+#define CONFIG_WIFI_OTA_HTTP_TIMEOUT_MS             5000
+#define CONFIG_WIFI_OTA_MAX_RESUMES                 10
+#define CONFIG_WIFI_OTA_WRITER_STACK_SIZE           4096
+#define CONFIG_WIFI_OTA_WRITER_PRIORITY             5
+// Shorter waits than menuconfig so the host tests run fast
+#define CONFIG_WIFI_OTA_RECONNECT_TIMEOUT_MS        300
+#define CONFIG_WIFI_OTA_RESUME_DELAY_MS             5
+#define CONFIG_WIFI_CONN_POOL_SIZE                  2
+#define CONFIG_WIFI_CONN_SESSION_CACHE              2
+#define CONFIG_WIFI_CONN_HOST_MAX_LEN               64
+#define CONFIG_WIFI_CONN_TIMEOUT_MS                 200
+#define CONFIG_WIFI_CONN_IDLE_TIMEOUT_MS            60000
+#define CONFIG_WIFI_CONN_KEEPALIVE_IDLE_S           30
+#define CONFIG_WIFI_CONN_KEEPALIVE_INTERVAL_S       10
+#define CONFIG_WIFI_CONN_KEEPALIVE_COUNT            3
+#define CONFIG_WIFI_CONN_RTC_SESSION                1
+#define CONFIG_WIFI_CONN_RTC_SESSION_SIZE           1536
+#define CONFIG_BOOTSTRAP_MAX_STEPS                  12
+#define CONFIG_BOOTSTRAP_STACK_SIZE                 4096
+#define CONFIG_BOOTSTRAP_TASK_PRIORITY              5
+// Shorter than menuconfig so the timeout test runs fast
+#define CONFIG_BOOTSTRAP_TIMEOUT_MS                 300
@@ -0,0 +1,592 @@
+/**
+ * @brief Host test of the wifi_conn pool and TLS session cache against a TLS server
+ * wifi_conn.c is built as is; the mbedtls client API is the OpenSSL backed
+ * stand-in (stubs/mbedtls_ssl_host.c), so connections run real TLS 1.2 or 1.3
+ * handshakes over sockets. The server is an OpenSSL thread on 127.0.0.1 with a
+ * certificate made at start-up: it echoes data, sends one ticket after each
+ * TLS 1.3 handshake, resumes sessions from its tickets and counts full and
+ * abbreviated handshakes. Each listening port stands for another server.
+ */
+#include "wifi_conn.h"
+#include "wifi_sta.h"
+#include "host_test.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_crt_bundle.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define SERVER_PORTS    4
+#define WAIT_MS         2000
+
+/**
+ * @brief TLS echo server on loopback
+ * Counters are updated by the connection threads: check them with server_wait.
+ */
+typedef struct {
+    SSL_CTX *ctx;
+    int listen_fd[SERVER_PORTS];
+    uint16_t port[SERVER_PORTS];
+    pthread_t thread;
+    // Behaviour
+    bool tls13;                 // TLS 1.3, else TLS 1.2 at most
+    uint32_t generation;        // Connections of an older generation are closed by the server
+    bool drop_notify;           // Send close notify when closing them
+    // Recorded
+    uint32_t connects;
+    uint32_t full;
+    uint32_t resumed;
+    uint32_t closed;            // Connections ended, either side
+    uint32_t close_notify;      // Close notify received from the client
+} server_t;
+
+EventGroupHandle_t e_wifi_event_group = NULL;
+esp_event_base_t const WIFI_EVENT = "WIFI_EVENT";
+
+static server_t s_server;
+static char s_ca_pem[4096];
+static char s_other_ca_pem[4096];
+static wifi_conn_target_t s_target_a;
+static wifi_conn_target_t s_target_b;
+static wifi_conn_target_t s_target_c;
+static wifi_conn_target_t s_target_d;      // No session cached: full handshakes only
+static int64_t s_now_us = 0;
+static esp_event_handler_t s_disconnect_handler = NULL;
+
+/******************************
+ * ESP-IDF stand-ins
+ */
+
+int64_t esp_timer_get_time(void)
+{
+    // Every call is 1 ms later, so cache and pool ages always differ
+    s_now_us += 1000;
+    return s_now_us;
+}
+
+void esp_fill_random(void *buf, size_t len)
+{
+    memset (buf, 0x5A, len);
+}
+
+esp_err_t esp_crt_bundle_attach(void *conf)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED){
+        s_disconnect_handler = event_handler;
+    }
+    return ESP_OK;
+}
+
+/******************************
+ * TLS server
+ */
+
+#define SERVER_GET(field)   __atomic_load_n (&s_server.field, __ATOMIC_SEQ_CST)
+#define SERVER_INC(field)   __atomic_add_fetch (&s_server.field, 1, __ATOMIC_SEQ_CST)
+
+/**
+ * @brief Wait until a server counter reaches value
+ */
+static bool server_wait (const uint32_t *counter, uint32_t value)
+{
+    for (int i = 0; i < WAIT_MS; i++){
+        if (__atomic_load_n (counter, __ATOMIC_SEQ_CST) == value){
+            return true;
+        }
+        usleep (1000);
+    }
+    fprintf (stderr, "server counter %u, expected %u\n", (unsigned) *counter, (unsigned) value);
+    return false;
+}
+
+/**
+ * @brief Self-signed certificate for localhost, in PEM
+ */
+static X509 *server_make_cert (EVP_PKEY *key, char *pem, size_t pem_size)
+{
+    X509 *cert = X509_new ();
+    X509_set_version (cert, 2);
+    ASN1_INTEGER_set (X509_get_serialNumber (cert), 1);
+    X509_gmtime_adj (X509_getm_notBefore (cert), -3600);
+    X509_gmtime_adj (X509_getm_notAfter (cert), 3600);
+    X509_set_pubkey (cert, key);
+    X509_NAME *name = X509_get_subject_name (cert);
+    X509_NAME_add_entry_by_txt (name, "CN", MBSTRING_ASC, (const unsigned char*) "localhost", -1, -1, 0);
+    X509_set_issuer_name (cert, name);
+    X509V3_CTX v3;
+    X509V3_set_ctx_nodb (&v3);
+    X509V3_set_ctx (&v3, cert, cert, NULL, NULL, 0);
+    static const struct { int nid; const char *value; } extensions[] = {
+        { NID_basic_constraints, "critical,CA:TRUE" },
+        { NID_subject_alt_name, "DNS:localhost" },
+    };
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++){
+        X509_EXTENSION *ext = X509V3_EXT_conf_nid (NULL, &v3, extensions[i].nid, extensions[i].value);
+        X509_add_ext (cert, ext, -1);
+        X509_EXTENSION_free (ext);
+    }
+    X509_sign (cert, key, EVP_sha256 ());
+
+    BIO *bio = BIO_new (BIO_s_mem ());
+    PEM_write_bio_X509 (bio, cert);
+    char *data = NULL;
+    long len = BIO_get_mem_data (bio, &data);
+    HOST_CHECK (len > 0 && (size_t) len < pem_size);
+    memcpy (pem, data, (size_t) len);
+    pem[len] = '\0';
+    BIO_free (bio);
+    return cert;
+}
+
+static void *server_conn_thread (void *arg)
+{
+    int fd = (int) (intptr_t) arg;
+    uint32_t generation = SERVER_GET (generation);
+    SSL *ssl = SSL_new (s_server.ctx);
+    SSL_set_fd (ssl, fd);
+    SSL_set_max_proto_version (ssl, SERVER_GET (tls13) ? TLS1_3_VERSION : TLS1_2_VERSION);
+    struct timeval timeout = { .tv_sec = 1 };
+    setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (SSL_accept (ssl) == 1){
+        SSL_session_reused (ssl) ? SERVER_INC (resumed) : SERVER_INC (full);
+        unsigned char buf[256];
+        while (1){
+            if (SERVER_GET (generation) != generation){
+                if (SERVER_GET (drop_notify)){
+                    SSL_shutdown (ssl);
+                }
+                break;
+            }
+            struct pollfd pfd = { .fd = fd, .events = POLLIN };
+            if (!SSL_has_pending (ssl) && poll (&pfd, 1, 10) == 0){
+                continue;
+            }
+            int ret = SSL_read (ssl, buf, sizeof(buf));
+            if (ret > 0){
+                SSL_write (ssl, buf, ret);
+                continue;
+            }
+            int error = SSL_get_error (ssl, ret);
+            if (error == SSL_ERROR_WANT_READ){
+                continue;
+            }
+            if (error == SSL_ERROR_ZERO_RETURN){
+                SERVER_INC (close_notify);
+            }
+            break;
+        }
+    }
+    ERR_clear_error ();
+    SSL_free (ssl);
+    close (fd);
+    SERVER_INC (closed);
+    return NULL;
+}
+
+static void *server_thread (void *arg)
+{
+    struct pollfd pfd[SERVER_PORTS];
+    for (int i = 0; i < SERVER_PORTS; i++){
+        pfd[i] = (struct pollfd) { .fd = s_server.listen_fd[i], .events = POLLIN };
+    }
+    while (poll (pfd, SERVER_PORTS, -1) > 0){
+        for (int i = 0; i < SERVER_PORTS; i++){
+            if (!(pfd[i].revents & POLLIN)){
+                continue;
+            }
+            int fd = accept (pfd[i].fd, NULL, NULL);
+            if (fd < 0){
+                return NULL;
+            }
+            SERVER_INC (connects);
+            pthread_t thread;
+            pthread_create (&thread, NULL, server_conn_thread, (void*) (intptr_t) fd);
+            pthread_detach (thread);
+        }
+    }
+    return NULL;
+}
+
+static int server_listen (uint16_t *port, int backlog)
+{
+    int fd = socket (AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl (INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    HOST_CHECK (bind (fd, (struct sockaddr*) &addr, sizeof(addr)) == 0);
+    HOST_CHECK (listen (fd, backlog) == 0);
+    getsockname (fd, (struct sockaddr*) &addr, &addr_len);
+    *port = ntohs (addr.sin_port);
+    return fd;
+}
+
+static void server_start (void)
+{
+    EVP_PKEY *key = EVP_EC_gen ("P-256");
+    X509 *cert = server_make_cert (key, s_ca_pem, sizeof(s_ca_pem));
+    // Same name, another key: must be rejected
+    EVP_PKEY *other_key = EVP_EC_gen ("P-256");
+    X509_free (server_make_cert (other_key, s_other_ca_pem, sizeof(s_other_ca_pem)));
+    EVP_PKEY_free (other_key);
+
+    s_server.ctx = SSL_CTX_new (TLS_server_method ());
+    SSL_CTX_use_certificate (s_server.ctx, cert);
+    SSL_CTX_use_PrivateKey (s_server.ctx, key);
+    SSL_CTX_set_min_proto_version (s_server.ctx, TLS1_2_VERSION);
+    SSL_CTX_set_num_tickets (s_server.ctx, 1);
+    SSL_CTX_clear_mode (s_server.ctx, SSL_MODE_AUTO_RETRY);
+    X509_free (cert);
+    EVP_PKEY_free (key);
+
+    for (int i = 0; i < SERVER_PORTS; i++){
+        s_server.listen_fd[i] = server_listen (&s_server.port[i], 8);
+    }
+    pthread_create (&s_server.thread, NULL, server_thread, NULL);
+}
+
+/**
+ * @brief The server closes its open connections, with or without close notify
+ */
+static void server_drop (bool notify)
+{
+    __atomic_store_n (&s_server.drop_notify, notify, __ATOMIC_SEQ_CST);
+    SERVER_INC (generation);
+    HOST_CHECK (server_wait (&s_server.closed, SERVER_GET (connects)));
+}
+
+/**
+ * @brief Empty pool and zeroed counters, the session cache is kept
+ */
+static void server_reset (bool tls13)
+{
+    wifi_conn_close_all();
+    HOST_CHECK (server_wait (&s_server.closed, SERVER_GET (connects)));
+    __atomic_store_n (&s_server.tls13, tls13, __ATOMIC_SEQ_CST);
+    __atomic_store_n (&s_server.connects, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n (&s_server.full, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n (&s_server.resumed, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n (&s_server.closed, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n (&s_server.close_notify, 0, __ATOMIC_SEQ_CST);
+}
+
+/******************************
+ * Tests
+ */
+
+/**
+ * @brief Request and echoed reply on a pooled connection
+ */
+static void exchange (wifi_conn_handle_t conn)
+{
+    char reply[8];
+    size_t received = 0;
+    HOST_CHECK (wifi_conn_write (conn, "ping", 4) == ESP_OK);
+    HOST_CHECK (wifi_conn_read (conn, reply, sizeof(reply), &received) == ESP_OK);
+    HOST_CHECK (received == 4 && memcmp (reply, "ping", 4) == 0);
+}
+
+/**
+ * @brief New connection (closed on release) to target, exchanging one message
+ */
+static void one_shot (const wifi_conn_target_t *target)
+{
+    wifi_conn_handle_t conn = NULL;
+    HOST_CHECK (wifi_conn_acquire (target, &conn) == ESP_OK);
+    if (conn != NULL){
+        exchange (conn);
+        wifi_conn_release (conn, false);
+    }
+}
+
+static void test_reuse (void)
+{
+    server_reset (false);
+    wifi_conn_stats_t before, after;
+    wifi_conn_get_stats (&before);
+    wifi_conn_handle_t first = NULL, second = NULL;
+    HOST_CHECK (wifi_conn_acquire (&s_target_a, &first) == ESP_OK);
+    exchange (first);
+    wifi_conn_release (first, true);
+    HOST_CHECK (wifi_conn_acquire (&s_target_a, &second) == ESP_OK);
+    HOST_CHECK (second == first);
+    exchange (second);
+    wifi_conn_release (second, true);
+    wifi_conn_get_stats (&after);
+    HOST_CHECK (SERVER_GET (connects) == 1);
+    HOST_CHECK (after.reused == before.reused + 1);
+}
+
+/**
+ * @brief TLS 1.2: the session exported after the handshake survives the release
+ */
+static void test_resume_tls12 (void)
+{
+    server_reset (false);
+    for (int i = 0; i < 4; i++){
+        one_shot (&s_target_b);
+    }
+    HOST_CHECK (server_wait (&s_server.connects, 4));
+    HOST_CHECK (server_wait (&s_server.full, 1));
+    HOST_CHECK (server_wait (&s_server.resumed, 3));
+    // Released without keep-alive: closed with a close notify
+    HOST_CHECK (server_wait (&s_server.close_notify, 4));
+}
+
+/**
+ * @brief TLS 1.3: the ticket received after the handshake is cached on release,
+ * a connection that got no new ticket keeps the cached one
+ */
+static void test_resume_tls13 (void)
+{
+    server_reset (true);
+    one_shot (&s_target_c);
+    HOST_CHECK (server_wait (&s_server.full, 1));
+    one_shot (&s_target_c);
+    HOST_CHECK (server_wait (&s_server.resumed, 1));
+
+    // Released before the ticket is read: the cache keeps the previous one
+    wifi_conn_handle_t conn = NULL;
+    HOST_CHECK (wifi_conn_acquire (&s_target_c, &conn) == ESP_OK);
+    wifi_conn_release (conn, false);
+    one_shot (&s_target_c);
+    HOST_CHECK (server_wait (&s_server.resumed, 3));
+    HOST_CHECK (SERVER_GET (full) == 1);
+}
+
+/**
+ * @brief TLS 1.3 ticket waiting on an idle pooled connection: the connection
+ * is reused and the ticket cached
+ */
+static void test_idle_ticket (void)
+{
+    server_reset (true);
+    wifi_conn_stats_t before, after;
+    wifi_conn_get_stats (&before);
+    wifi_conn_handle_t conn = NULL, again = NULL;
+    HOST_CHECK (wifi_conn_acquire (&s_target_a, &conn) == ESP_OK);
+    wifi_conn_release (conn, true);
+    HOST_CHECK (server_wait (&s_server.full, 1));
+    // The ticket follows the handshake
+    usleep (50 * 1000);
+    HOST_CHECK (wifi_conn_acquire (&s_target_a, &again) == ESP_OK);
+    HOST_CHECK (again == conn);
+    exchange (again);
+    wifi_conn_release (again, false);
+    wifi_conn_get_stats (&after);
+    HOST_CHECK (after.reused == before.reused + 1 && after.dropped == before.dropped);
+    HOST_CHECK (SERVER_GET (connects) == 1);
+
+    // The next connection resumes with the ticket read while pooled
+    one_shot (&s_target_a);
+    HOST_CHECK (server_wait (&s_server.resumed, 1));
+    HOST_CHECK (SERVER_GET (full) == 1);
+}
+
+static void test_session_cache_eviction (void)
+{
+    // Cache of 2: a third server evicts the oldest session (a)
+    server_reset (false);
+    one_shot (&s_target_a);
+    one_shot (&s_target_b);
+    one_shot (&s_target_c);
+    one_shot (&s_target_b);
+    one_shot (&s_target_c);
+    HOST_CHECK (server_wait (&s_server.connects, 5));
+    HOST_CHECK (server_wait (&s_server.resumed, 2));
+    one_shot (&s_target_a);
+    HOST_CHECK (server_wait (&s_server.full, 4));
+}
+
+static void test_pool_full_and_lru (void)
+{
+    server_reset (false);
+    wifi_conn_handle_t a = NULL, b = NULL, c = NULL;
+    HOST_CHECK (wifi_conn_acquire (&s_target_a, &a) == ESP_OK);
+    HOST_CHECK (wifi_conn_acquire (&s_target_b, &b) == ESP_OK);
+    HOST_CHECK (wifi_conn_acquire (&s_target_c, &c) == ESP_ERR_NOT_FOUND);
+    wifi_conn_release (a, true);
+    wifi_conn_release (b, true);
+
+    // c takes the least recently used slot (a), b stays pooled
+    HOST_CHECK (wifi_conn_acquire (&s_target_c, &c) == ESP_OK);
+    HOST_CHECK (c == a);
+    exchange (c);
+    wifi_conn_release (c, true);
+    HOST_CHECK (server_wait (&s_server.connects, 3));
+    wifi_conn_handle_t again = NULL;
+    HOST_CHECK (wifi_conn_acquire (&s_target_b, &again) == ESP_OK);
+    HOST_CHECK (again == b);
+    exchange (again);
+    wifi_conn_release (again, true);
+    HOST_CHECK (SERVER_GET (connects) == 3);
+}
+
+static void test_idle_and_peer_closed (void)
+{
+    server_reset (false);
+    wifi_conn_handle_t conn = NULL;
+    HOST_CHECK (wifi_conn_acquire (&s_target_a, &conn) == ESP_OK);
+    wifi_conn_release (conn, true);
+
+    // Idle for too long: replaced, with an abbreviated handshake
+    s_now_us += (int64_t) CONFIG_WIFI_CONN_IDLE_TIMEOUT_MS * 1000;
+    HOST_CHECK (wifi_conn_acquire (&s_target_a, &conn) == ESP_OK);
+    HOST_CHECK (server_wait (&s_server.closed, 1));
+    HOST_CHECK (server_wait (&s_server.resumed, 1));
+    wifi_conn_release (conn, true);
+
+    // Closed by the server while pooled, with and without close notify: replaced
+    static const bool notify[] = { true, false };
+    for (size_t i = 0; i < sizeof(notify) / sizeof(notify[0]); i++){
+        server_drop (notify[i]);
+        HOST_CHECK (wifi_conn_acquire (&s_target_a, &conn) == ESP_OK);
+        HOST_CHECK (server_wait (&s_server.connects, 3 + i));
+        HOST_CHECK (server_wait (&s_server.resumed, 2 + i));
+        exchange (conn);
+        wifi_conn_release (conn, true);
+    }
+}
+
+static void test_disconnect (void)
+{
+    server_reset (false);
+    wifi_conn_stats_t before, after;
+    wifi_conn_get_stats (&before);
+    wifi_conn_handle_t busy = NULL, idle = NULL;
+    HOST_CHECK (wifi_conn_acquire (&s_target_a, &busy) == ESP_OK);
+    HOST_CHECK (wifi_conn_acquire (&s_target_b, &idle) == ESP_OK);
+    wifi_conn_release (idle, true);
+    for (int i = 0; i < WAIT_MS && SERVER_GET (full) + SERVER_GET (resumed) < 2; i++){
+        usleep (1000);
+    }
+    uint32_t resumed = SERVER_GET (resumed);
+
+    // WIFI_EVENT_STA_DISCONNECTED: idle connection closed now, busy one on release
+    HOST_CHECK (s_disconnect_handler != NULL);
+    s_disconnect_handler (NULL, WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, NULL);
+    HOST_CHECK (server_wait (&s_server.closed, 1));
+    HOST_CHECK (wifi_conn_write (busy, "ping", 4) == ESP_FAIL);
+    wifi_conn_release (busy, true);
+    HOST_CHECK (server_wait (&s_server.closed, 2));
+    // No close notify over a lost link
+    HOST_CHECK (SERVER_GET (close_notify) == 0);
+    wifi_conn_get_stats (&after);
+    HOST_CHECK (after.dropped == before.dropped + 2);
+
+    // Link back: both servers resume their cached sessions
+    one_shot (&s_target_a);
+    one_shot (&s_target_b);
+    HOST_CHECK (server_wait (&s_server.resumed, resumed + 2));
+}
+
+static void test_wrong_ca (void)
+{
+    server_reset (false);
+    wifi_conn_target_t target = s_target_d;
+    target.ca_pem = s_other_ca_pem;
+    wifi_conn_handle_t conn = NULL;
+    HOST_CHECK (wifi_conn_acquire (&target, &conn) == ESP_FAIL);
+    HOST_CHECK (server_wait (&s_server.closed, 1));
+    HOST_CHECK (SERVER_GET (full) == 0 && SERVER_GET (resumed) == 0);
+}
+
+/**
+ * @brief A server that never answers the SYN, and a closed port
+ */
+static void test_connect_timeout (void)
+{
+    // Accept queue full: further SYNs are dropped and the connect stays pending
+    uint16_t port;
+    int listen_fd = server_listen (&port, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons (port),
+                                .sin_addr.s_addr = htonl (INADDR_LOOPBACK) };
+    int fillers[4];
+    for (int i = 0; i < 4; i++){
+        fillers[i] = socket (AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        connect (fillers[i], (struct sockaddr*) &addr, sizeof(addr));
+    }
+    usleep (10 * 1000);
+    wifi_conn_target_t target = s_target_a;
+    target.port = port;
+    wifi_conn_handle_t conn = NULL;
+    uint64_t start_ns = host_now_ns ();
+    HOST_CHECK (wifi_conn_acquire (&target, &conn) == ESP_FAIL);
+    uint64_t elapsed_ms = (host_now_ns () - start_ns) / 1000000;
+    // CONFIG_WIFI_CONN_TIMEOUT_MS per address of localhost
+    HOST_CHECK (elapsed_ms >= CONFIG_WIFI_CONN_TIMEOUT_MS - 10 && elapsed_ms < 4 * CONFIG_WIFI_CONN_TIMEOUT_MS);
+    for (int i = 0; i < 4; i++){
+        close (fillers[i]);
+    }
+
+    // Closed port: fails at once
+    close (listen_fd);
+    start_ns = host_now_ns ();
+    HOST_CHECK (wifi_conn_acquire (&target, &conn) == ESP_FAIL);
+    HOST_CHECK ((host_now_ns () - start_ns) / 1000000 < CONFIG_WIFI_CONN_TIMEOUT_MS);
+}
+
+static void test_no_ipv4 (void)
+{
+    wifi_conn_handle_t conn = NULL;
+    xEventGroupClearBits (e_wifi_event_group, WIFI_STA_IPV4_OBTAINED_BIT);
+    HOST_CHECK (wifi_conn_acquire (&s_target_a, &conn) == ESP_ERR_TIMEOUT);
+    xEventGroupSetBits (e_wifi_event_group, WIFI_STA_IPV4_OBTAINED_BIT);
+}
+
+static void test_invalid_args (void)
+{
+    wifi_conn_handle_t conn = NULL;
+    const wifi_conn_target_t no_host = { .host = NULL, .port = 443 };
+    HOST_CHECK (wifi_conn_acquire (NULL, &conn) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK (wifi_conn_acquire (&no_host, &conn) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK (wifi_conn_acquire (&s_target_a, NULL) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK (wifi_conn_get_stats (NULL) == ESP_ERR_INVALID_ARG);
+}
+
+int main (void)
+{
+    // Writes to connections the server closed
+    signal (SIGPIPE, SIG_IGN);
+    server_start();
+    s_target_a = (wifi_conn_target_t) { .host = "localhost", .port = s_server.port[0], .ca_pem = s_ca_pem };
+    s_target_b = (wifi_conn_target_t) { .host = "localhost", .port = s_server.port[1], .ca_pem = s_ca_pem };
+    s_target_c = (wifi_conn_target_t) { .host = "localhost", .port = s_server.port[2], .ca_pem = s_ca_pem };
+    s_target_d = (wifi_conn_target_t) { .host = "localhost", .port = s_server.port[3], .ca_pem = s_ca_pem };
+
+    HOST_CHECK (wifi_conn_init() == ESP_ERR_INVALID_STATE);
+    e_wifi_event_group = xEventGroupCreate();
+    xEventGroupSetBits (e_wifi_event_group, WIFI_STA_IPV4_OBTAINED_BIT);
+    HOST_CHECK (wifi_conn_init() == ESP_OK);
+
+    test_invalid_args();
+    test_reuse();
+    test_resume_tls12();
+    test_resume_tls13();
+    test_idle_ticket();
+    test_session_cache_eviction();
+    test_pool_full_and_lru();
+    test_idle_and_peer_closed();
+    test_disconnect();
+    test_wrong_ca();
+    test_connect_timeout();
+    test_no_ipv4();
+    return host_test_result();
+}
@@ -0,0 +1,382 @@
+/**
+ * @brief Host test of the wifi_ota download pipeline
+ * The image comes from a stand-in of the HTTP server (Range requests, dropped
+ * connections) and goes to a file-backed emulation of the OTA partition.
+ * A dropped connection clears WIFI_STA_IPV4_OBTAINED_BIT and a stand-in of the
+ * wifi_sta reconnect path sets it again a little later, as on the device.
+ */
+#include "wifi_ota.h"
+#include "wifi_sta.h"
+#include "host_test.h"
+#include "mbedtls/sha256.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IMAGE_SIZE          100003      // Not a multiple of the buffer size
+#define PARTITION_SIZE      (128 * 1024)
+#define MAX_DROPS           16
+#define MAX_REQUESTS        32
+#define SEGMENT_SIZE        1460        // Bytes per read, like one TCP segment
+
+EventGroupHandle_t e_wifi_event_group = NULL;
+
+static uint8_t s_image[IMAGE_SIZE];
+static uint8_t s_image_sha[32];
+
+/**
+ * @brief HTTP server stand-in serving s_image
+ */
+typedef struct {
+    bool ignore_range;              // Answer 200 with the whole image to Range requests
+    bool reconnect;                 // Stand-in reconnect path brings the network back
+    size_t drop_at[MAX_DROPS];      // Image offsets where the connection is lost (increasing)
+    uint8_t drop_num;
+    // Recorded
+    uint8_t drops;
+    size_t range[MAX_REQUESTS];     // Offset asked by each request
+    uint8_t requests;
+    size_t pos;                     // Next image byte of the open response
+    pthread_t reader;
+} server_t;
+
+/**
+ * @brief File-backed OTA partition emulation
+ */
+typedef struct {
+    FILE *file;
+    size_t size;
+    size_t offset;                  // Sequential writes only, like OTA_WITH_SEQUENTIAL_WRITES
+    size_t writes;
+    size_t max_write;
+    pthread_t writer;
+    bool booted;
+    bool aborted;
+} partition_t;
+
+/******************************
+ * Stand-in of the wifi_sta reconnect path
+ */
+
+static void reconnect_task (void *arg)
+{
+    vTaskDelay (pdMS_TO_TICKS(20));
+    xEventGroupSetBits (e_wifi_event_group, WIFI_STA_IPV4_OBTAINED_BIT);
+    vTaskDelete (NULL);
+}
+
+static void link_lost (server_t *server)
+{
+    xEventGroupClearBits (e_wifi_event_group, WIFI_STA_IPV4_OBTAINED_BIT);
+    // wifi_ota_run must have enabled the reconnect path
+    if (server->reconnect && (xEventGroupGetBits (e_wifi_event_group) & WIFI_CHOSEN_STA_RECONENCT)){
+        xTaskCreate (reconnect_task, "reconnect", 2048, NULL, 5, NULL);
+    }
+}
+
+/******************************
+ * HTTP server stand-in
+ */
+
+static esp_err_t server_open (void *ctx, size_t offset, int *status, int64_t *content_length)
+{
+    server_t *server = (server_t*) ctx;
+    server->reader = pthread_self();
+    if (server->requests < MAX_REQUESTS){
+        server->range[server->requests] = offset;
+    }
+    server->requests++;
+    if (offset > 0 && !server->ignore_range){
+        *status = 206;
+        server->pos = offset;
+    }
+    else {
+        *status = 200;
+        server->pos = 0;
+    }
+    *content_length = IMAGE_SIZE - server->pos;
+    return ESP_OK;
+}
+
+static int server_read (void *ctx, uint8_t *buf, size_t len)
+{
+    server_t *server = (server_t*) ctx;
+    size_t end = IMAGE_SIZE;
+    if (server->drops < server->drop_num){
+        end = server->drop_at[server->drops];
+        if (server->pos >= end){
+            server->drops++;
+            link_lost (server);
+            return -1;
+        }
+    }
+    size_t n = end - server->pos;
+    n = n < len ? n : len;
+    n = n < SEGMENT_SIZE ? n : SEGMENT_SIZE;
+    memcpy (buf, s_image + server->pos, n);
+    server->pos += n;
+    return (int) n;
+}
+
+static bool server_is_complete (void *ctx)
+{
+    server_t *server = (server_t*) ctx;
+    return server->pos == IMAGE_SIZE;
+}
+
+static void server_close (void *ctx)
+{
+}
+
+/******************************
+ * File-backed partition
+ */
+
+static esp_err_t partition_begin (void *ctx)
+{
+    partition_t *partition = (partition_t*) ctx;
+    partition->file = tmpfile();
+    if (partition->file == NULL){
+        return ESP_FAIL;
+    }
+    // Erased flash reads 0xFF
+    uint8_t erased[4096];
+    memset (erased, 0xFF, sizeof(erased));
+    for (size_t i = 0; i < partition->size; i += sizeof(erased)){
+        fwrite (erased, 1, sizeof(erased), partition->file);
+    }
+    rewind (partition->file);
+    return ESP_OK;
+}
+
+static esp_err_t partition_write (void *ctx, const uint8_t *data, size_t len)
+{
+    partition_t *partition = (partition_t*) ctx;
+    if (partition->offset + len > partition->size){
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (fwrite (data, 1, len, partition->file) != len){
+        return ESP_FAIL;
+    }
+    partition->offset += len;
+    partition->writes++;
+    partition->writer = pthread_self();
+    partition->max_write = len > partition->max_write ? len : partition->max_write;
+    return ESP_OK;
+}
+
+static esp_err_t partition_end (void *ctx)
+{
+    partition_t *partition = (partition_t*) ctx;
+    partition->booted = true;
+    return ESP_OK;
+}
+
+static void partition_abort (void *ctx)
+{
+    partition_t *partition = (partition_t*) ctx;
+    partition->aborted = true;
+}
+
+static bool partition_holds_image (partition_t *partition)
+{
+    static uint8_t content[IMAGE_SIZE];
+    fflush (partition->file);
+    rewind (partition->file);
+    return fread (content, 1, IMAGE_SIZE, partition->file) == IMAGE_SIZE &&
+           memcmp (content, s_image, IMAGE_SIZE) == 0;
+}
+
+/******************************
+ * Tests
+ */
+
+static wifi_ota_source_t s_source = {
+    .open = server_open,
+    .read = server_read,
+    .is_complete = server_is_complete,
+    .close = server_close,
+};
+
+static wifi_ota_sink_t s_sink = {
+    .begin = partition_begin,
+    .write = partition_write,
+    .end = partition_end,
+    .abort = partition_abort,
+};
+
+/**
+ * @brief Defaults of the host build: the stand-ins replace esp_http_client and esp_ota_ops
+ */
+const wifi_ota_source_t *wifi_ota_source_http(const char *url, const char *cert_pem)
+{
+    return &s_source;
+}
+
+const wifi_ota_sink_t *wifi_ota_sink_flash(void)
+{
+    return &s_sink;
+}
+
+/**
+ * @brief Update through the config (explicit) or through the default source and sink
+ */
+static esp_err_t run (server_t *server, partition_t *partition, const uint8_t *sha256, bool explicit)
+{
+    s_source.ctx = server;
+    s_sink.ctx = partition;
+    const wifi_ota_config_t config = {
+        .url = "http://127.0.0.1/firmware.bin",
+        .sha256 = sha256,
+        .source = explicit ? &s_source : NULL,
+        .sink = explicit ? &s_sink : NULL,
+    };
+    if (partition->size == 0){
+        partition->size = PARTITION_SIZE;
+    }
+    xEventGroupSetBits (e_wifi_event_group, WIFI_STA_IPV4_OBTAINED_BIT);
+    return wifi_ota_run (&config);
+}
+
+static void test_clean_download (void)
+{
+    server_t server = { .reconnect = true };
+    partition_t partition = { 0 };
+    HOST_CHECK (run (&server, &partition, s_image_sha, false) == ESP_OK);
+    HOST_CHECK (partition_holds_image (&partition));
+    HOST_CHECK (partition.booted && !partition.aborted);
+    HOST_CHECK (partition.max_write == CONFIG_WIFI_OTA_BUFFER_SIZE);
+    HOST_CHECK (partition.writes == (IMAGE_SIZE + CONFIG_WIFI_OTA_BUFFER_SIZE - 1) / CONFIG_WIFI_OTA_BUFFER_SIZE);
+    HOST_CHECK (server.requests == 1 && server.range[0] == 0);
+    // Flash writes run beside the network reads
+    HOST_CHECK (!pthread_equal (partition.writer, server.reader));
+
+    wifi_ota_progress_t progress;
+    HOST_CHECK (wifi_ota_get_progress (&progress) == ESP_OK);
+    HOST_CHECK (progress.received == IMAGE_SIZE && progress.written == IMAGE_SIZE);
+    HOST_CHECK (progress.total == IMAGE_SIZE && progress.resumes == 0);
+    // Reconnect was not chosen before the update: restored
+    HOST_CHECK (!(xEventGroupGetBits (e_wifi_event_group) & WIFI_CHOSEN_STA_RECONENCT));
+    fclose (partition.file);
+}
+
+static void test_resume_after_disconnect (void)
+{
+    // Drops in the middle of a buffer and on a buffer boundary
+    server_t server = {
+        .reconnect = true,
+        .drop_at = { 30001, 8 * CONFIG_WIFI_OTA_BUFFER_SIZE, IMAGE_SIZE - 1 },
+        .drop_num = 3,
+    };
+    partition_t partition = { 0 };
+    xEventGroupSetBits (e_wifi_event_group, WIFI_CHOSEN_STA_RECONENCT);
+    HOST_CHECK (run (&server, &partition, s_image_sha, true) == ESP_OK);
+    HOST_CHECK (partition_holds_image (&partition));
+    HOST_CHECK (partition.booted && !partition.aborted);
+    HOST_CHECK (server.drops == 3);
+    // Each resumed request asks for the missing part only
+    HOST_CHECK (server.requests == 4);
+    HOST_CHECK (server.range[0] == 0 && server.range[1] == 30001);
+    HOST_CHECK (server.range[2] == 8 * CONFIG_WIFI_OTA_BUFFER_SIZE && server.range[3] == IMAGE_SIZE - 1);
+
+    wifi_ota_progress_t progress;
+    wifi_ota_get_progress (&progress);
+    HOST_CHECK (progress.resumes == 3 && progress.written == IMAGE_SIZE);
+    // Reconnect was chosen by the application: left set
+    HOST_CHECK (xEventGroupGetBits (e_wifi_event_group) & WIFI_CHOSEN_STA_RECONENCT);
+    xEventGroupClearBits (e_wifi_event_group, WIFI_CHOSEN_STA_RECONENCT);
+    fclose (partition.file);
+}
+
+static void test_server_ignores_range (void)
+{
+    server_t server = { .reconnect = true, .ignore_range = true, .drop_at = { 50000 }, .drop_num = 1 };
+    partition_t partition = { 0 };
+    HOST_CHECK (run (&server, &partition, s_image_sha, true) == ESP_OK);
+    HOST_CHECK (partition_holds_image (&partition));
+    HOST_CHECK (server.requests == 2 && server.range[1] == 50000);
+    fclose (partition.file);
+}
+
+static void test_hash_mismatch (void)
+{
+    uint8_t wrong_sha[32];
+    memcpy (wrong_sha, s_image_sha, sizeof(wrong_sha));
+    wrong_sha[31] ^= 1;
+    server_t server = { .reconnect = true, .drop_at = { 40000 }, .drop_num = 1 };
+    partition_t partition = { 0 };
+    HOST_CHECK (run (&server, &partition, wrong_sha, true) == ESP_ERR_INVALID_CRC);
+    HOST_CHECK (partition.aborted && !partition.booted);
+    fclose (partition.file);
+}
+
+static void test_partition_full (void)
+{
+    server_t server = { .reconnect = true };
+    partition_t partition = { .size = IMAGE_SIZE / 2 };
+    HOST_CHECK (run (&server, &partition, NULL, true) == ESP_ERR_INVALID_SIZE);
+    HOST_CHECK (partition.aborted && !partition.booted);
+    fclose (partition.file);
+}
+
+static void test_network_not_restored (void)
+{
+    server_t server = { .reconnect = false, .drop_at = { 20000 }, .drop_num = 1 };
+    partition_t partition = { 0 };
+    HOST_CHECK (run (&server, &partition, s_image_sha, true) == ESP_ERR_TIMEOUT);
+    HOST_CHECK (partition.aborted && !partition.booted);
+    HOST_CHECK (server.requests == 1);
+    HOST_CHECK (!(xEventGroupGetBits (e_wifi_event_group) & WIFI_CHOSEN_STA_RECONENCT));
+    fclose (partition.file);
+}
+
+static void test_too_many_resumes (void)
+{
+    server_t server = { .reconnect = true, .drop_num = MAX_DROPS };
+    for (int i = 0; i < MAX_DROPS; i++){
+        server.drop_at[i] = (size_t) (i + 1) * 5000;
+    }
+    partition_t partition = { 0 };
+    HOST_CHECK (run (&server, &partition, s_image_sha, true) == ESP_ERR_TIMEOUT);
+    HOST_CHECK (server.requests == CONFIG_WIFI_OTA_MAX_RESUMES + 1);
+    HOST_CHECK (partition.aborted);
+    fclose (partition.file);
+}
+
+static void test_invalid_args (void)
+{
+    HOST_CHECK (wifi_ota_run (NULL) == ESP_ERR_INVALID_ARG);
+    wifi_ota_config_t config = { .url = NULL };
+    HOST_CHECK (wifi_ota_run (&config) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK (wifi_ota_get_progress (NULL) == ESP_ERR_INVALID_ARG);
+}
+
+int main (void)
+{
+    for (size_t i = 0; i < IMAGE_SIZE; i++){
+        s_image[i] = (uint8_t) host_rand();
+    }
+    mbedtls_sha256 (s_image, IMAGE_SIZE, s_image_sha, 0);
+    // Known answer for the SHA-256 stand-in ("abc", FIPS 180-2)
+    static const uint8_t abc_sha[32] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+    };
+    uint8_t digest[32];
+    mbedtls_sha256 ((const unsigned char*) "abc", 3, digest, 0);
+    HOST_CHECK (memcmp (digest, abc_sha, sizeof(digest)) == 0);
+
+    e_wifi_event_group = xEventGroupCreate();
+    test_invalid_args();
+    test_clean_download();
+    test_resume_after_disconnect();
+    test_server_ignores_range();
+    test_hash_mismatch();
+    test_partition_full();
+    test_network_not_restored();
+    test_too_many_resumes();
+    return host_test_result();
+}
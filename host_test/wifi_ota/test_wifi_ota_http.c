@@ -0,0 +1,398 @@
+/**
+ * @brief Host test of the wifi_ota HTTP image source
+ * wifi_ota.c and wifi_ota_http.c are built as is against the esp_http_client
+ * stand-in (plain HTTP over sockets) and download from a server thread on
+ * loopback: Range requests answered with 206 or ignored (200), connections
+ * closed or reset mid-transfer, requests left without an answer, redirects
+ * and error statuses. The image goes to a RAM partition.
+ */
+#include "wifi_ota.h"
+#include "wifi_sta.h"
+#include "host_test.h"
+#include "esp_crt_bundle.h"
+#include "mbedtls/sha256.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define IMAGE_SIZE          100003      // Not a multiple of the buffer size
+#define PARTITION_SIZE      (128 * 1024)
+#define MAX_DROPS           4
+#define MAX_REQUESTS        16
+#define SEGMENT_SIZE        1460
+#define IMAGE_PATH          "/firmware.bin"
+
+EventGroupHandle_t e_wifi_event_group = NULL;
+
+static uint8_t s_image[IMAGE_SIZE];
+static uint8_t s_image_sha[32];
+
+/**
+ * @brief HTTP server on loopback serving s_image at IMAGE_PATH
+ */
+typedef struct {
+    int listen_fd;
+    uint16_t port;
+    pthread_t thread;
+    // Behaviour
+    bool ignore_range;              // Answer 200 with the whole image to Range requests
+    bool reset;                     // Drops are a TCP reset instead of a close
+    size_t drop_at[MAX_DROPS];      // Image offsets where the connection is lost (increasing)
+    uint8_t drop_num;
+    uint8_t no_response;            // Requests closed without an answer
+    const char *redirect_from;      // Answered with 302 to redirect_to
+    const char *redirect_to;
+    // Recorded
+    uint8_t drops;
+    uint8_t connections;
+    uint8_t requests;
+    char path[MAX_REQUESTS][32];
+    long range[MAX_REQUESTS];       // -1: no Range header
+} server_t;
+
+/**
+ * @brief RAM partition
+ */
+typedef struct {
+    uint8_t data[PARTITION_SIZE];
+    size_t offset;
+    bool booted;
+    bool aborted;
+} partition_t;
+
+static partition_t s_partition;
+
+/******************************
+ * ESP-IDF stand-ins
+ */
+
+esp_err_t esp_crt_bundle_attach(void *conf)
+{
+    return ESP_OK;
+}
+
+static esp_err_t partition_begin (void *ctx)
+{
+    partition_t *partition = (partition_t*) ctx;
+    memset (partition, 0, sizeof(*partition));
+    memset (partition->data, 0xFF, sizeof(partition->data));
+    return ESP_OK;
+}
+
+static esp_err_t partition_write (void *ctx, const uint8_t *data, size_t len)
+{
+    partition_t *partition = (partition_t*) ctx;
+    if (partition->offset + len > sizeof(partition->data)){
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy (partition->data + partition->offset, data, len);
+    partition->offset += len;
+    return ESP_OK;
+}
+
+static esp_err_t partition_end (void *ctx)
+{
+    ((partition_t*) ctx)->booted = true;
+    return ESP_OK;
+}
+
+static void partition_abort (void *ctx)
+{
+    ((partition_t*) ctx)->aborted = true;
+}
+
+const wifi_ota_sink_t *wifi_ota_sink_flash(void)
+{
+    static const wifi_ota_sink_t sink = {
+        .begin = partition_begin,
+        .write = partition_write,
+        .end = partition_end,
+        .abort = partition_abort,
+        .ctx = &s_partition,
+    };
+    return &sink;
+}
+
+/******************************
+ * Loopback HTTP server
+ */
+
+static bool server_send (int fd, const void *data, size_t len)
+{
+    return send (fd, data, len, MSG_NOSIGNAL) == (ssize_t) len;
+}
+
+/**
+ * @brief Read one request head, false when the client closed the connection
+ */
+static bool server_request (server_t *server, int fd, char *path, size_t path_size, long *range)
+{
+    char head[1024];
+    size_t len = 0;
+    while (len == 0 || strstr (head, "\r\n\r\n") == NULL){
+        ssize_t ret = recv (fd, head + len, sizeof(head) - 1 - len, 0);
+        if (ret <= 0 || len + ret >= sizeof(head) - 1){
+            return false;
+        }
+        len += (size_t) ret;
+        head[len] = '\0';
+    }
+    char format[16];
+    snprintf (format, sizeof(format), "GET %%%us", (unsigned) path_size - 1);
+    if (sscanf (head, format, path) != 1){
+        return false;
+    }
+    const char *range_header = strstr (head, "\r\nRange: bytes=");
+    *range = range_header ? strtol (range_header + 15, NULL, 10) : -1;
+    if (server->requests < MAX_REQUESTS){
+        snprintf (server->path[server->requests], sizeof(server->path[0]), "%s", path);
+        server->range[server->requests] = *range;
+    }
+    server->requests++;
+    return true;
+}
+
+/**
+ * @brief Send the image from the requested offset, false if the connection is dropped
+ */
+static bool server_send_image (server_t *server, int fd, long range)
+{
+    size_t start = (range > 0 && !server->ignore_range) ? (size_t) range : 0;
+    char head[256];
+    int len;
+    if (start > 0){
+        len = snprintf (head, sizeof(head), "HTTP/1.1 206 Partial Content\r\nContent-Length: %u\r\n"
+                        "Content-Range: bytes %u-%u/%u\r\n\r\n", (unsigned) (IMAGE_SIZE - start),
+                        (unsigned) start, (unsigned) IMAGE_SIZE - 1, (unsigned) IMAGE_SIZE);
+    }
+    else {
+        len = snprintf (head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n", (unsigned) IMAGE_SIZE);
+    }
+    size_t end = IMAGE_SIZE;
+    bool drop = server->drops < server->drop_num && server->drop_at[server->drops] < IMAGE_SIZE;
+    if (drop){
+        end = server->drop_at[server->drops];
+    }
+    if (!server_send (fd, head, (size_t) len)){
+        return false;
+    }
+    for (size_t pos = start; pos < end; pos += SEGMENT_SIZE){
+        size_t n = end - pos < SEGMENT_SIZE ? end - pos : SEGMENT_SIZE;
+        if (!server_send (fd, s_image + pos, n)){
+            return false;
+        }
+    }
+    if (drop){
+        server->drops++;
+        return false;
+    }
+    return true;
+}
+
+static void *server_thread (void *arg)
+{
+    server_t *server = (server_t*) arg;
+    int fd;
+    while ((fd = accept (server->listen_fd, NULL, NULL)) >= 0){
+        server->connections++;
+        char path[32];
+        long range;
+        bool keep = true;
+        while (keep && server_request (server, fd, path, sizeof(path), &range)){
+            if (server->no_response > 0){
+                server->no_response--;
+                keep = false;
+            }
+            else if (server->redirect_from != NULL && strcmp (path, server->redirect_from) == 0){
+                char head[256];
+                int len = snprintf (head, sizeof(head), "HTTP/1.1 302 Found\r\nLocation: %s\r\n"
+                                    "Content-Length: 5\r\n\r\nmoved", server->redirect_to);
+                keep = server_send (fd, head, (size_t) len);
+            }
+            else if (strcmp (path, IMAGE_PATH) == 0){
+                keep = server_send_image (server, fd, range);
+            }
+            else {
+                static const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+                keep = server_send (fd, not_found, sizeof(not_found) - 1);
+            }
+        }
+        if (server->reset){
+            // Close with a RST: the client read fails instead of seeing the end of the stream
+            struct linger linger = { .l_onoff = 1, .l_linger = 0 };
+            setsockopt (fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+        }
+        close (fd);
+    }
+    return NULL;
+}
+
+static void server_start (server_t *server)
+{
+    server->listen_fd = socket (AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl (INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    HOST_CHECK (bind (server->listen_fd, (struct sockaddr*) &addr, sizeof(addr)) == 0);
+    HOST_CHECK (listen (server->listen_fd, 4) == 0);
+    getsockname (server->listen_fd, (struct sockaddr*) &addr, &addr_len);
+    server->port = ntohs (addr.sin_port);
+    pthread_create (&server->thread, NULL, server_thread, server);
+}
+
+static void server_stop (server_t *server)
+{
+    // Wakes accept(); the connection of the last request is closed by the client
+    shutdown (server->listen_fd, SHUT_RDWR);
+    pthread_join (server->thread, NULL);
+    close (server->listen_fd);
+}
+
+/******************************
+ * Tests
+ */
+
+/**
+ * @brief Update from path on the server through the default HTTP source
+ */
+static esp_err_t run (server_t *server, const char *path)
+{
+    server_start (server);
+    char url[64];
+    snprintf (url, sizeof(url), "http://127.0.0.1:%u%s", server->port, path);
+    const wifi_ota_config_t config = {
+        .url = url,
+        .sha256 = s_image_sha,
+    };
+    xEventGroupSetBits (e_wifi_event_group, WIFI_STA_IPV4_OBTAINED_BIT);
+    esp_err_t esp_ret = wifi_ota_run (&config);
+    server_stop (server);
+    return esp_ret;
+}
+
+static bool partition_holds_image (void)
+{
+    return s_partition.booted && !s_partition.aborted && s_partition.offset == IMAGE_SIZE &&
+           memcmp (s_partition.data, s_image, IMAGE_SIZE) == 0;
+}
+
+static uint8_t resumes (void)
+{
+    wifi_ota_progress_t progress;
+    wifi_ota_get_progress (&progress);
+    return progress.resumes;
+}
+
+static void test_clean_download (void)
+{
+    server_t server = { 0 };
+    HOST_CHECK (run (&server, IMAGE_PATH) == ESP_OK);
+    HOST_CHECK (partition_holds_image ());
+    HOST_CHECK (server.requests == 1 && server.range[0] == -1);
+    HOST_CHECK (server.connections == 1);
+    wifi_ota_progress_t progress;
+    wifi_ota_get_progress (&progress);
+    HOST_CHECK (progress.total == IMAGE_SIZE && progress.resumes == 0);
+}
+
+static void test_resume_after_close (void)
+{
+    // In the middle of a buffer and on a buffer boundary
+    server_t server = { .drop_at = { 30001, 8 * CONFIG_WIFI_OTA_BUFFER_SIZE }, .drop_num = 2 };
+    HOST_CHECK (run (&server, IMAGE_PATH) == ESP_OK);
+    HOST_CHECK (partition_holds_image ());
+    HOST_CHECK (server.drops == 2 && resumes () == 2);
+    // Each resumed request asks for the missing part only and gets 206
+    HOST_CHECK (server.requests == 3);
+    HOST_CHECK (server.range[0] == -1 && server.range[1] == 30001);
+    HOST_CHECK (server.range[2] == 8 * CONFIG_WIFI_OTA_BUFFER_SIZE);
+}
+
+static void test_resume_after_reset (void)
+{
+    // Read errors instead of the end of the stream; the reset may discard data in flight
+    server_t server = { .reset = true, .drop_at = { 50000 }, .drop_num = 1 };
+    HOST_CHECK (run (&server, IMAGE_PATH) == ESP_OK);
+    HOST_CHECK (partition_holds_image ());
+    HOST_CHECK (server.requests == 2 && server.range[1] > 0 && server.range[1] <= 50000);
+    HOST_CHECK (resumes () == 1);
+}
+
+static void test_server_ignores_range (void)
+{
+    // 200 with the whole image: the bytes already received are skipped
+    server_t server = { .ignore_range = true, .drop_at = { 50000 }, .drop_num = 1 };
+    HOST_CHECK (run (&server, IMAGE_PATH) == ESP_OK);
+    HOST_CHECK (partition_holds_image ());
+    HOST_CHECK (server.requests == 2 && server.range[1] == 50000);
+}
+
+static void test_no_response (void)
+{
+    server_t server = { .no_response = 2 };
+    HOST_CHECK (run (&server, IMAGE_PATH) == ESP_OK);
+    HOST_CHECK (partition_holds_image ());
+    HOST_CHECK (server.requests == 3 && resumes () == 2);
+}
+
+static void test_redirect (void)
+{
+    server_t server = {
+        .redirect_from = "/latest.bin",
+        .redirect_to = IMAGE_PATH,
+        .drop_at = { 40000 },
+        .drop_num = 1,
+    };
+    HOST_CHECK (run (&server, "/latest.bin") == ESP_OK);
+    HOST_CHECK (partition_holds_image ());
+    // Resumed from the original URL, the Range header follows the redirect
+    HOST_CHECK (server.requests == 4);
+    HOST_CHECK (strcmp (server.path[0], "/latest.bin") == 0 && server.range[0] == -1);
+    HOST_CHECK (strcmp (server.path[1], IMAGE_PATH) == 0 && server.range[1] == -1);
+    HOST_CHECK (strcmp (server.path[2], "/latest.bin") == 0 && server.range[2] == 40000);
+    HOST_CHECK (strcmp (server.path[3], IMAGE_PATH) == 0 && server.range[3] == 40000);
+    // Same host: the redirect reuses the connection
+    HOST_CHECK (server.connections == 2);
+}
+
+static void test_redirect_loop (void)
+{
+    server_t server = { .redirect_from = "/loop.bin", .redirect_to = "/loop.bin" };
+    HOST_CHECK (run (&server, "/loop.bin") == ESP_FAIL);
+    HOST_CHECK (s_partition.aborted && !s_partition.booted);
+    // First request and the redirects followed (OTA_HTTP_MAX_REDIRECTS), never resumed
+    HOST_CHECK (server.requests == 6);
+    HOST_CHECK (resumes () == 0);
+}
+
+static void test_not_found (void)
+{
+    server_t server = { 0 };
+    HOST_CHECK (run (&server, "/missing.bin") == ESP_FAIL);
+    HOST_CHECK (s_partition.aborted && !s_partition.booted);
+    HOST_CHECK (server.requests == 1 && resumes () == 0);
+}
+
+int main (void)
+{
+    for (size_t i = 0; i < IMAGE_SIZE; i++){
+        s_image[i] = (uint8_t) host_rand();
+    }
+    mbedtls_sha256 (s_image, IMAGE_SIZE, s_image_sha, 0);
+
+    e_wifi_event_group = xEventGroupCreate();
+    test_clean_download();
+    test_resume_after_close();
+    test_resume_after_reset();
+    test_server_ignores_range();
+    test_no_response();
+    test_redirect();
+    test_redirect_loop();
+    test_not_found();
+    return host_test_result();
+}
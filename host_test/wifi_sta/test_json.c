@@ -0,0 +1,310 @@
+/**
+ * @brief Host test and benchmark of wifi_sta_json
+ * Encodes synthetic scans of 10, 60 and 500 APs through a counting output and checks
+ * the document against snprintf, that every flush fits the buffer and that nothing is
+ * allocated: the memory used stays the caller buffer whatever the AP count.
+ * malloc, calloc and realloc are wrapped at link time (-Wl,--wrap) to count calls.
+ */
+#include "wifi_sta_json.h"
+#include "host_test.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define MAX_AP          500
+#define CHUNK_SIZE      CONFIG_WIFI_STA_HTTP_CHUNK_SIZE
+#define DOC_SIZE        (MAX_AP * 160 + 64)
+
+static wifi_ap_record_t s_scan[MAX_AP];
+static char s_expected[DOC_SIZE];
+static char s_output[DOC_SIZE];
+
+/**
+ * @brief Allocation counters, the encoder must not touch the heap
+ */
+static size_t s_alloc_calls = 0;
+
+void *__real_malloc (size_t size);
+void *__real_calloc (size_t num, size_t size);
+void *__real_realloc (void *ptr, size_t size);
+
+void *__wrap_malloc (size_t size)
+{
+    s_alloc_calls++;
+    return __real_malloc (size);
+}
+
+void *__wrap_calloc (size_t num, size_t size)
+{
+    s_alloc_calls++;
+    return __real_calloc (num, size);
+}
+
+void *__wrap_realloc (void *ptr, size_t size)
+{
+    s_alloc_calls++;
+    return __real_realloc (ptr, size);
+}
+
+/**
+ * @brief Output that records what the encoder hands over
+ */
+typedef struct {
+    char *out;              // NULL: only count
+    size_t out_len;
+    size_t flushes;
+    size_t max_flush;
+    esp_err_t fail_err;     // Returned by flush number fail_after (fail_after 0: never)
+    size_t fail_after;
+} sink_t;
+
+static esp_err_t sink_flush (void *ctx, const char *data, size_t len)
+{
+    sink_t *sink = (sink_t*) ctx;
+    sink->flushes++;
+    if (len > sink->max_flush){
+        sink->max_flush = len;
+    }
+    if (sink->fail_after != 0 && sink->flushes == sink->fail_after){
+        return sink->fail_err;
+    }
+    if (sink->out != NULL){
+        memcpy (sink->out + sink->out_len, data, len);
+    }
+    sink->out_len += len;
+    return ESP_OK;
+}
+
+static void make_scan (uint16_t ap_num)
+{
+    for (uint16_t i = 0; i < ap_num; i++){
+        memset (&s_scan[i], 0, sizeof(s_scan[i]));
+        // Full length SSIDs with characters that need escaping on some records
+        if (i % 7 == 0){
+            snprintf ((char*) s_scan[i].ssid, sizeof(s_scan[i].ssid), "q\"uote\\d\x01net%u", (unsigned) i);
+        }
+        else if (i % 11 == 0){
+            // Valid UTF-8 is copied as is, also across flushes
+            snprintf ((char*) s_scan[i].ssid, sizeof(s_scan[i].ssid), "caf\xc3\xa9 \xf0\x9f\x93\xb6 %u", (unsigned) i);
+        }
+        else {
+            memset (s_scan[i].ssid, 'a' + i % 26, sizeof(s_scan[i].ssid));
+        }
+        for (int b = 0; b < 6; b++){
+            s_scan[i].bssid[b] = (uint8_t) host_rand();
+        }
+        s_scan[i].rssi = (int8_t) -(20 + (int) (host_rand() % 75));
+        s_scan[i].primary = (uint8_t) (1 + host_rand() % 13);
+        s_scan[i].authmode = (wifi_auth_mode_t) (host_rand() % WIFI_AUTH_MAX);
+    }
+}
+
+/**
+ * @brief Reference document, written with snprintf
+ */
+static size_t expected_doc (uint16_t ap_num)
+{
+    size_t n = (size_t) snprintf (s_expected, sizeof(s_expected), "{\"ap_num\":%u,\"aps\":[", ap_num);
+    for (uint16_t i = 0; i < ap_num; i++){
+        const wifi_ap_record_t *ap = &s_scan[i];
+        char ssid[sizeof(ap->ssid) * 6 + 1];
+        size_t s = 0;
+        for (size_t c = 0; c < sizeof(ap->ssid) && ap->ssid[c] != '\0'; c++){
+            if (ap->ssid[c] == '"' || ap->ssid[c] == '\\'){
+                ssid[s++] = '\\';
+                ssid[s++] = (char) ap->ssid[c];
+            }
+            else if (ap->ssid[c] < 0x20){
+                s += (size_t) sprintf (ssid + s, "\\u%04x", ap->ssid[c]);
+            }
+            else {
+                ssid[s++] = (char) ap->ssid[c];
+            }
+        }
+        ssid[s] = '\0';
+        n += (size_t) snprintf (s_expected + n, sizeof(s_expected) - n,
+                                "%s{\"ssid\":\"%s\",\"bssid\":\"%02x:%02x:%02x:%02x:%02x:%02x\","
+                                "\"channel\":%u,\"rssi\":%d,\"authmode\":%d}",
+                                i ? "," : "", ssid,
+                                ap->bssid[0], ap->bssid[1], ap->bssid[2], ap->bssid[3], ap->bssid[4], ap->bssid[5],
+                                ap->primary, ap->rssi, (int) ap->authmode);
+    }
+    n += (size_t) snprintf (s_expected + n, sizeof(s_expected) - n, "]}");
+    return n;
+}
+
+/**
+ * @brief Same document as GET /scan
+ */
+static esp_err_t encode_scan (char *buf, size_t size, sink_t *sink, uint16_t ap_num, size_t *total)
+{
+    wifi_sta_json_t json;
+    wifi_sta_json_init (&json, buf, size, sink_flush, sink);
+    wifi_sta_json_object_begin (&json, NULL);
+    wifi_sta_json_int (&json, "ap_num", ap_num);
+    wifi_sta_json_array_begin (&json, "aps");
+    for (uint16_t i = 0; i < ap_num && json.err == ESP_OK; i++){
+        wifi_sta_json_ap_record (&json, NULL, &s_scan[i]);
+    }
+    wifi_sta_json_array_end (&json);
+    wifi_sta_json_object_end (&json);
+    esp_err_t esp_ret = wifi_sta_json_finish (&json);
+    if (total != NULL){
+        *total = json.total;
+    }
+    return esp_ret;
+}
+
+static void test_scan_document (uint16_t ap_num)
+{
+    char buf[CHUNK_SIZE];
+    sink_t sink = { .out = s_output };
+    size_t total = 0;
+    make_scan (ap_num);
+    size_t expected_len = expected_doc (ap_num);
+
+    size_t alloc_before = s_alloc_calls;
+    HOST_CHECK (encode_scan (buf, sizeof(buf), &sink, ap_num, &total) == ESP_OK);
+    HOST_CHECK (s_alloc_calls == alloc_before);
+
+    HOST_CHECK (total == expected_len);
+    HOST_CHECK (sink.out_len == expected_len);
+    HOST_CHECK (memcmp (s_output, s_expected, expected_len) == 0);
+    // Only full buffers are flushed, plus the remainder on finish
+    HOST_CHECK (sink.max_flush <= sizeof(buf));
+    HOST_CHECK (sink.flushes == (expected_len + sizeof(buf) - 1) / sizeof(buf));
+    printf ("json %3u APs: %6zu bytes in %3zu flushes of <= %zu bytes, encoder state %zu + buffer %zu bytes, %zu allocations\n",
+            ap_num, total, sink.flushes, sink.max_flush, sizeof(wifi_sta_json_t), sizeof(buf),
+            s_alloc_calls - alloc_before);
+}
+
+/**
+ * @brief Smallest buffer: every byte is a flush, the document must not change
+ */
+static void test_tiny_buffer (void)
+{
+    char buf[1];
+    sink_t sink = { .out = s_output };
+    make_scan (10);
+    size_t expected_len = expected_doc (10);
+    HOST_CHECK (encode_scan (buf, sizeof(buf), &sink, 10, NULL) == ESP_OK);
+    HOST_CHECK (sink.out_len == expected_len);
+    HOST_CHECK (memcmp (s_output, s_expected, expected_len) == 0);
+    HOST_CHECK (sink.flushes == expected_len);
+}
+
+static void test_errors (void)
+{
+    char buf[16];
+    wifi_sta_json_t json;
+    sink_t sink = { .out = s_output };
+
+    // Output error is sticky and reported by finish, no more flushes after it
+    make_scan (60);
+    sink = (sink_t) { .out = s_output, .fail_after = 3, .fail_err = ESP_FAIL };
+    HOST_CHECK (encode_scan (buf, sizeof(buf), &sink, 60, NULL) == ESP_FAIL);
+    HOST_CHECK (sink.flushes == 3);
+
+    // Unbalanced containers
+    sink = (sink_t) { .out = s_output };
+    wifi_sta_json_init (&json, buf, sizeof(buf), sink_flush, &sink);
+    wifi_sta_json_object_begin (&json, NULL);
+    HOST_CHECK (wifi_sta_json_finish (&json) == ESP_ERR_INVALID_STATE);
+    wifi_sta_json_init (&json, buf, sizeof(buf), sink_flush, &sink);
+    wifi_sta_json_array_end (&json);
+    HOST_CHECK (wifi_sta_json_finish (&json) == ESP_ERR_INVALID_STATE);
+
+    // Too deep
+    wifi_sta_json_init (&json, buf, sizeof(buf), sink_flush, &sink);
+    for (int i = 0; i < WIFI_STA_JSON_MAX_DEPTH; i++){
+        wifi_sta_json_array_begin (&json, NULL);
+    }
+    HOST_CHECK (wifi_sta_json_finish (&json) == ESP_ERR_INVALID_STATE);
+
+    // Invalid arguments
+    wifi_sta_json_init (&json, NULL, sizeof(buf), sink_flush, &sink);
+    HOST_CHECK (wifi_sta_json_finish (&json) == ESP_ERR_INVALID_ARG);
+    wifi_sta_json_init (&json, buf, sizeof(buf), NULL, &sink);
+    HOST_CHECK (wifi_sta_json_finish (&json) == ESP_ERR_INVALID_ARG);
+
+    // Integer limits and null strings
+    sink = (sink_t) { .out = s_output };
+    wifi_sta_json_init (&json, buf, sizeof(buf), sink_flush, &sink);
+    wifi_sta_json_array_begin (&json, NULL);
+    wifi_sta_json_int (&json, NULL, INT64_MIN);
+    wifi_sta_json_int (&json, NULL, INT64_MAX);
+    wifi_sta_json_int (&json, NULL, 0);
+    wifi_sta_json_string (&json, NULL, NULL, 0);
+    wifi_sta_json_bool (&json, NULL, false);
+    wifi_sta_json_array_end (&json);
+    HOST_CHECK (wifi_sta_json_finish (&json) == ESP_OK);
+    const char *expected = "[-9223372036854775808,9223372036854775807,0,null,false]";
+    HOST_CHECK (sink.out_len == strlen (expected) && memcmp (s_output, expected, sink.out_len) == 0);
+}
+
+/**
+ * @brief One string through the encoder
+ */
+static bool encodes_to (const char *value, size_t max_len, const char *expected)
+{
+    char buf[8];
+    wifi_sta_json_t json;
+    sink_t sink = { .out = s_output };
+    wifi_sta_json_init (&json, buf, sizeof(buf), sink_flush, &sink);
+    wifi_sta_json_string (&json, NULL, value, max_len);
+    return wifi_sta_json_finish (&json) == ESP_OK &&
+           sink.out_len == strlen (expected) && memcmp (s_output, expected, sink.out_len) == 0;
+}
+
+/**
+ * @brief SSIDs are arbitrary octets: invalid UTF-8 is escaped byte by byte
+ */
+static void test_utf8 (void)
+{
+    HOST_CHECK (encodes_to ("caf\xc3\xa9", 32, "\"caf\xc3\xa9\""));
+    HOST_CHECK (encodes_to ("\xe2\x82\xac\xf0\x9f\x93\xb6", 32, "\"\xe2\x82\xac\xf0\x9f\x93\xb6\""));
+    // Latin-1 and stray continuation bytes
+    HOST_CHECK (encodes_to ("caf\xe9", 32, "\"caf\\u00e9\""));
+    HOST_CHECK (encodes_to ("\xff\xfe\x80", 32, "\"\\u00ff\\u00fe\\u0080\""));
+    // Overlong, surrogate and above U+10FFFF
+    HOST_CHECK (encodes_to ("\xc0\xaf", 32, "\"\\u00c0\\u00af\""));
+    HOST_CHECK (encodes_to ("\xe0\x80\xaf", 32, "\"\\u00e0\\u0080\\u00af\""));
+    HOST_CHECK (encodes_to ("\xed\xa0\x80", 32, "\"\\u00ed\\u00a0\\u0080\""));
+    HOST_CHECK (encodes_to ("\xf4\x90\x80\x80", 32, "\"\\u00f4\\u0090\\u0080\\u0080\""));
+    // Cut by max_len or a NUL, bad continuation byte
+    HOST_CHECK (encodes_to ("\xe2\x82\xac", 2, "\"\\u00e2\\u0082\""));
+    HOST_CHECK (encodes_to ("a\xc3", 32, "\"a\\u00c3\""));
+    HOST_CHECK (encodes_to ("\xc3" "A", 32, "\"\\u00c3A\""));
+}
+
+static void benchmark (uint16_t ap_num)
+{
+    char buf[CHUNK_SIZE];
+    make_scan (ap_num);
+    int iterations = 2000000 / ap_num;
+    size_t total = 0;
+
+    uint64_t start_ns = host_now_ns();
+    for (int i = 0; i < iterations; i++){
+        sink_t sink = { .out = NULL };
+        encode_scan (buf, sizeof(buf), &sink, ap_num, &total);
+    }
+    uint64_t elapsed_ns = host_now_ns() - start_ns;
+    printf ("json %3u APs: %8llu ns/document, %6.1f MB/s\n", ap_num,
+            (unsigned long long) (elapsed_ns / iterations),
+            (double) total * iterations * 1000.0 / (double) elapsed_ns);
+}
+
+int main (void)
+{
+    test_scan_document (10);
+    test_scan_document (60);
+    test_scan_document (MAX_AP);
+    test_tiny_buffer();
+    test_errors();
+    test_utf8();
+    benchmark (10);
+    benchmark (60);
+    benchmark (MAX_AP);
+    return host_test_result();
+}
@@ -0,0 +1,222 @@
+/**
+ * @brief Host test and benchmark of wifi_sta_scan_filter
+ * Checks the in-place filter against a straightforward reference, then times it on
+ * synthetic scans of 10, 60 and 500 APs next to the copy + qsort approach it replaces.
+ */
+#include "wifi_sta.h"
+#include "host_test.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define MAX_AP      500
+
+static wifi_ap_record_t s_scan[MAX_AP];
+static wifi_ap_record_t s_work[MAX_AP];
+static wifi_ap_record_t s_expected[MAX_AP];
+
+/**
+ * @brief Synthetic scan: ssid_num networks, several BSSIDs each, on 2.4 GHz and 5 GHz channels
+ */
+static const uint8_t s_channels[] = { 1, 6, 11, 13, 36, 40, 100, 149, 165 };
+
+static void make_scan (wifi_ap_record_t *ap_record, uint16_t ap_num, uint16_t ssid_num)
+{
+    for (uint16_t i = 0; i < ap_num; i++){
+        memset (&ap_record[i], 0, sizeof(ap_record[i]));
+        snprintf ((char*) ap_record[i].ssid, sizeof(ap_record[i].ssid), "net%u", (unsigned) (host_rand() % ssid_num));
+        if (host_rand() % 20 == 0){
+            ap_record[i].ssid[0] = '\0';    // Hidden network
+        }
+        for (int b = 0; b < 6; b++){
+            ap_record[i].bssid[b] = (uint8_t) host_rand();
+        }
+        ap_record[i].rssi = (int8_t) -(20 + (int) (host_rand() % 75));
+        ap_record[i].primary = s_channels[host_rand() % sizeof(s_channels)];
+        ap_record[i].authmode = (wifi_auth_mode_t) (host_rand() % WIFI_AUTH_MAX);
+    }
+}
+
+static int compare_rssi_desc (const void *a, const void *b)
+{
+    return ((const wifi_ap_record_t*) b)->rssi - ((const wifi_ap_record_t*) a)->rssi;
+}
+
+/**
+ * @brief Reference: same stages, written the obvious way
+ */
+static uint16_t reference_filter (const wifi_ap_record_t *in, uint16_t ap_num,
+                                  const wifi_sta_scan_filter_t *filter, wifi_ap_record_t *out)
+{
+    uint16_t kept = 0;
+    for (uint16_t i = 0; i < ap_num; i++){
+        const wifi_ap_record_t *ap = &in[i];
+        if (ap->rssi < filter->rssi_floor || ap->authmode < filter->min_authmode){
+            continue;
+        }
+        bool any_channel = true;
+        for (int w = 0; w < WIFI_STA_SCAN_CHANNEL_WORDS; w++){
+            any_channel = any_channel && filter->channel_mask[w] == 0;
+        }
+        if (!any_channel && !WIFI_STA_SCAN_CHANNEL_IS_SET(filter->channel_mask, ap->primary)){
+            continue;
+        }
+        if (filter->ssid != NULL && strcmp ((const char*) ap->ssid, filter->ssid) != 0){
+            continue;
+        }
+        if (filter->dedupe_ssid && ap->ssid[0] != '\0'){
+            uint16_t j = 0;
+            while (j < kept && strcmp ((const char*) out[j].ssid, (const char*) ap->ssid) != 0){
+                j++;
+            }
+            if (j < kept){
+                if (ap->rssi > out[j].rssi){
+                    out[j] = *ap;
+                }
+                continue;
+            }
+        }
+        out[kept++] = *ap;
+    }
+    if (filter->top_k != 0){
+        qsort (out, kept, sizeof(out[0]), compare_rssi_desc);
+        if (kept > filter->top_k){
+            kept = filter->top_k;
+        }
+    }
+    return kept;
+}
+
+static void random_filter (wifi_sta_scan_filter_t *filter)
+{
+    *filter = (wifi_sta_scan_filter_t) WIFI_STA_SCAN_FILTER_DEFAULT();
+    filter->dedupe_ssid = host_rand() % 2;
+    filter->top_k = host_rand() % 12;
+    filter->rssi_floor = (host_rand() % 2) ? -80 : -127;
+    filter->min_authmode = (host_rand() % 3 == 0) ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN;
+    if (host_rand() % 2){
+        WIFI_STA_SCAN_CHANNEL_SET(filter->channel_mask, 1);
+        WIFI_STA_SCAN_CHANNEL_SET(filter->channel_mask, 6);
+        WIFI_STA_SCAN_CHANNEL_SET(filter->channel_mask, 149);
+    }
+    if (host_rand() % 4 == 0){
+        filter->ssid = "net3";
+    }
+}
+
+static void test_matches_reference (void)
+{
+    for (int iter = 0; iter < 5000; iter++){
+        // Some large scans with many SSIDs fill the dedupe index
+        bool large = (iter % 50 == 0);
+        uint16_t ap_num = large ? host_rand() % MAX_AP : host_rand() % 80;
+        wifi_sta_scan_filter_t filter;
+        make_scan (s_scan, ap_num, large ? 1 + host_rand() % 400 : 1 + host_rand() % 20);
+        random_filter (&filter);
+        uint16_t expected_num = reference_filter (s_scan, ap_num, &filter, s_expected);
+
+        memcpy (s_work, s_scan, sizeof(s_scan[0]) * ap_num);
+        uint16_t num = ap_num;
+        HOST_CHECK (wifi_sta_scan_filter (s_work, &num, &filter) == ESP_OK);
+        HOST_CHECK (num == expected_num);
+        for (uint16_t i = 0; i < num; i++){
+            if (filter.top_k != 0){
+                // Equal RSSI may come in any order, only the ranking must match
+                HOST_CHECK (s_work[i].rssi == s_expected[i].rssi);
+            }
+            else {
+                HOST_CHECK (memcmp (&s_work[i], &s_expected[i], sizeof(s_work[i])) == 0);
+            }
+        }
+    }
+}
+
+static void test_channel_mask (void)
+{
+    // Only the 5 GHz channels 36 and 165, both ends of the mask words
+    wifi_ap_record_t ap_record[4] = {
+        { .ssid = "a", .primary = 1, .rssi = -40 },
+        { .ssid = "b", .primary = 36, .rssi = -50 },
+        { .ssid = "c", .primary = 165, .rssi = -60 },
+        { .ssid = "d", .primary = 255, .rssi = -70 },
+    };
+    uint16_t num = 4;
+    wifi_sta_scan_filter_t filter = WIFI_STA_SCAN_FILTER_DEFAULT();
+    WIFI_STA_SCAN_CHANNEL_SET(filter.channel_mask, 36);
+    WIFI_STA_SCAN_CHANNEL_SET(filter.channel_mask, 165);
+    HOST_CHECK (wifi_sta_scan_filter (ap_record, &num, &filter) == ESP_OK);
+    HOST_CHECK (num == 2);
+    HOST_CHECK (ap_record[0].primary == 36 && ap_record[1].primary == 165);
+}
+
+static void test_invalid_args (void)
+{
+    uint16_t num = 0;
+    wifi_sta_scan_filter_t filter = WIFI_STA_SCAN_FILTER_DEFAULT();
+    HOST_CHECK (wifi_sta_scan_filter (NULL, &num, &filter) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK (wifi_sta_scan_filter (s_work, NULL, &filter) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK (wifi_sta_scan_filter (s_work, &num, NULL) == ESP_ERR_INVALID_ARG);
+}
+
+/**
+ * @brief What the demo did before: copy, sort everything, then filter
+ */
+static uint16_t baseline_filter (const wifi_ap_record_t *in, uint16_t ap_num,
+                                 const wifi_sta_scan_filter_t *filter, wifi_ap_record_t *out)
+{
+    memcpy (out, in, sizeof(in[0]) * ap_num);
+    qsort (out, ap_num, sizeof(out[0]), compare_rssi_desc);
+    uint16_t kept = 0;
+    for (uint16_t i = 0; i < ap_num && kept < filter->top_k; i++){
+        uint16_t j = 0;
+        while (j < kept && strcmp ((const char*) out[j].ssid, (const char*) out[i].ssid) != 0){
+            j++;
+        }
+        if (j == kept && out[i].rssi >= filter->rssi_floor){
+            out[kept++] = out[i];
+        }
+    }
+    return kept;
+}
+
+static void benchmark (uint16_t ap_num)
+{
+    wifi_sta_scan_filter_t filter = WIFI_STA_SCAN_FILTER_DEFAULT();
+    filter.dedupe_ssid = true;
+    filter.top_k = 10;
+    filter.rssi_floor = -90;
+    make_scan (s_scan, ap_num, ap_num / 3 + 1);
+    int iterations = 2000000 / ap_num;
+
+    // The copy back into s_work is part of both loops so the two timings compare
+    uint64_t start_ns = host_now_ns();
+    volatile uint16_t sink = 0;
+    for (int i = 0; i < iterations; i++){
+        memcpy (s_work, s_scan, sizeof(s_scan[0]) * ap_num);
+        uint16_t num = ap_num;
+        wifi_sta_scan_filter (s_work, &num, &filter);
+        sink += num;
+    }
+    uint64_t filter_ns = (host_now_ns() - start_ns) / iterations;
+
+    start_ns = host_now_ns();
+    for (int i = 0; i < iterations; i++){
+        memcpy (s_work, s_scan, sizeof(s_scan[0]) * ap_num);
+        sink += baseline_filter (s_work, ap_num, &filter, s_expected);
+    }
+    uint64_t baseline_ns = (host_now_ns() - start_ns) / iterations;
+    (void) sink;
+    printf ("scan_filter %3u APs: %8llu ns/scan (copy + qsort + filter: %8llu ns/scan)\n",
+            ap_num, (unsigned long long) filter_ns, (unsigned long long) baseline_ns);
+}
+
+int main (void)
+{
+    test_matches_reference();
+    test_channel_mask();
+    test_invalid_args();
+    benchmark (10);
+    benchmark (60);
+    benchmark (MAX_AP);
+    return host_test_result();
+}
@@ -0,0 +1,252 @@
+/**
+ * @brief Host test of the adaptive scan scheduler
+ * Synthetic scans drive the period: stable scans stretch it to the maximum,
+ * APs appearing or disappearing, RSSI swings and disconnects reset it.
+ * Scans larger than CONFIG_WIFI_STA_SCAN_SCHED_MAX_AP (16 in the host build)
+ * check that the APs left out are not taken for churn.
+ */
+#include "wifi_sta_scan_sched.h"
+#include "host_test.h"
+#include <string.h>
+
+#define MAX_SCAN    48
+#define MIN_MS      1000
+#define MAX_MS      8000
+
+static int64_t s_now_us = 0;
+
+int64_t esp_timer_get_time(void)
+{
+    s_now_us += 1000;
+    return s_now_us;
+}
+
+/**
+ * @brief AP id in the BSSID, RSSI from -40 dBm down with the id
+ */
+static void make_ap (wifi_ap_record_t *ap, uint16_t id, int8_t rssi)
+{
+    memset (ap, 0, sizeof(*ap));
+    ap->bssid[0] = 0x02;
+    ap->bssid[4] = (uint8_t) (id >> 8);
+    ap->bssid[5] = (uint8_t) id;
+    ap->rssi = rssi;
+}
+
+static uint16_t make_scan (wifi_ap_record_t *scan, uint16_t first_id, uint16_t num)
+{
+    for (uint16_t i = 0; i < num; i++){
+        make_ap (&scan[i], first_id + i, (int8_t) (-40 - (first_id + i) % 40));
+    }
+    return num;
+}
+
+static wifi_sta_scan_sched_entry_t last_entry (void)
+{
+    wifi_sta_scan_sched_entry_t history[CONFIG_WIFI_STA_SCAN_SCHED_HISTORY];
+    uint16_t count = wifi_sta_scan_sched_get_history (history, CONFIG_WIFI_STA_SCAN_SCHED_HISTORY);
+    HOST_CHECK (count > 0);
+    return history[count - 1];
+}
+
+/**
+ * @brief Same scan until the period reaches the maximum
+ */
+static void stretch (const wifi_ap_record_t *scan, uint16_t num)
+{
+    for (int i = 0; i < 8 && wifi_sta_scan_sched_get_period () < MAX_MS; i++){
+        wifi_sta_scan_sched_update (scan, num);
+    }
+    HOST_CHECK (wifi_sta_scan_sched_get_period () == MAX_MS);
+}
+
+static void test_init (void)
+{
+    HOST_CHECK (wifi_sta_scan_sched_init (MAX_MS, MIN_MS) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK (wifi_sta_scan_sched_init (0, 0) == ESP_OK);
+    HOST_CHECK (wifi_sta_scan_sched_get_period () == CONFIG_WIFI_STA_SCAN_SCHED_MIN_MS);
+    wifi_sta_scan_sched_entry_t history[1];
+    HOST_CHECK (wifi_sta_scan_sched_get_history (history, 1) == 0);
+    HOST_CHECK (wifi_sta_scan_sched_get_history (NULL, 1) == 0);
+}
+
+static void test_stable_stretches (void)
+{
+    wifi_ap_record_t scan[MAX_SCAN];
+    uint16_t num = make_scan (scan, 0, 8);
+    wifi_sta_scan_sched_init (MIN_MS, MAX_MS);
+    HOST_CHECK (wifi_sta_scan_sched_update (scan, num) == MIN_MS);
+    HOST_CHECK (last_entry ().reason == WIFI_STA_SCAN_SCHED_FIRST);
+    // Doubles up to the maximum and stays there
+    static const uint32_t expected[] = { 2000, 4000, 8000, 8000, 8000 };
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++){
+        HOST_CHECK (wifi_sta_scan_sched_update (scan, num) == expected[i]);
+        wifi_sta_scan_sched_entry_t entry = last_entry ();
+        HOST_CHECK (entry.reason == WIFI_STA_SCAN_SCHED_STABLE && entry.churn == 0);
+        HOST_CHECK (entry.ap_num == 8 && entry.appeared == 0 && entry.disappeared == 0);
+    }
+    // Small RSSI jitter is still stable
+    for (uint16_t i = 0; i < num; i++){
+        scan[i].rssi += (i % 2) ? 2 : -2;
+    }
+    HOST_CHECK (wifi_sta_scan_sched_update (scan, num) == MAX_MS);
+    HOST_CHECK (last_entry ().reason == WIFI_STA_SCAN_SCHED_STABLE && last_entry ().rssi_variance == 4);
+}
+
+static void test_appear_disappear (void)
+{
+    wifi_ap_record_t scan[MAX_SCAN];
+    wifi_sta_scan_sched_init (MIN_MS, MAX_MS);
+    uint16_t num = make_scan (scan, 0, 8);
+    stretch (scan, num);
+
+    // 4 new APs out of 12: reset
+    num = make_scan (scan, 0, 12);
+    HOST_CHECK (wifi_sta_scan_sched_update (scan, num) == MIN_MS);
+    wifi_sta_scan_sched_entry_t entry = last_entry ();
+    HOST_CHECK (entry.reason == WIFI_STA_SCAN_SCHED_CHURN && entry.appeared == 4 && entry.disappeared == 0);
+    HOST_CHECK (entry.churn == 33);
+
+    // 4 gone out of 12: reset
+    stretch (scan, num);
+    num = make_scan (scan, 0, 8);
+    HOST_CHECK (wifi_sta_scan_sched_update (scan, num) == MIN_MS);
+    entry = last_entry ();
+    HOST_CHECK (entry.reason == WIFI_STA_SCAN_SCHED_CHURN && entry.appeared == 0 && entry.disappeared == 4);
+
+    // 1 new AP out of 9: period kept
+    stretch (scan, num);
+    num = make_scan (scan, 0, 9);
+    HOST_CHECK (wifi_sta_scan_sched_update (scan, num) == MAX_MS);
+    entry = last_entry ();
+    HOST_CHECK (entry.reason == WIFI_STA_SCAN_SCHED_HOLD && entry.appeared == 1 && entry.churn == 11);
+}
+
+static void test_rssi_swing (void)
+{
+    wifi_ap_record_t scan[MAX_SCAN];
+    wifi_sta_scan_sched_init (MIN_MS, MAX_MS);
+    uint16_t num = make_scan (scan, 0, 8);
+    stretch (scan, num);
+    for (uint16_t i = 0; i < num; i++){
+        scan[i].rssi -= 10;
+    }
+    HOST_CHECK (wifi_sta_scan_sched_update (scan, num) == MIN_MS);
+    wifi_sta_scan_sched_entry_t entry = last_entry ();
+    HOST_CHECK (entry.reason == WIFI_STA_SCAN_SCHED_CHURN && entry.rssi_variance == 100 && entry.churn == 100);
+    HOST_CHECK (entry.appeared == 0 && entry.disappeared == 0);
+}
+
+static void test_disconnect (void)
+{
+    wifi_ap_record_t scan[MAX_SCAN];
+    wifi_sta_scan_sched_init (MIN_MS, MAX_MS);
+    uint16_t num = make_scan (scan, 0, 8);
+    stretch (scan, num);
+    wifi_sta_scan_sched_notify_disconnect ();
+    HOST_CHECK (wifi_sta_scan_sched_get_period () == MIN_MS);
+    HOST_CHECK (last_entry ().reason == WIFI_STA_SCAN_SCHED_DISCONNECT && last_entry ().period_ms == MIN_MS);
+    // Stretches again from the minimum
+    HOST_CHECK (wifi_sta_scan_sched_update (scan, num) == 2 * MIN_MS);
+}
+
+static void test_history (void)
+{
+    wifi_ap_record_t scan[MAX_SCAN];
+    wifi_sta_scan_sched_init (MIN_MS, MAX_MS);
+    uint16_t num = make_scan (scan, 0, 8);
+    // 12 decisions in a ring of 8
+    static const uint32_t periods[] = { 1000, 2000, 4000, 1000, 2000, 4000, 8000, 8000, 1000, 1000, 1000, 2000 };
+    for (int i = 0; i < 12; i++){
+        if (i == 3 || i == 10){
+            wifi_sta_scan_sched_notify_disconnect ();
+        }
+        else if (i == 8){
+            wifi_sta_scan_sched_update (scan, 0);
+        }
+        else {
+            wifi_sta_scan_sched_update (scan, num);
+        }
+    }
+    wifi_sta_scan_sched_entry_t history[CONFIG_WIFI_STA_SCAN_SCHED_HISTORY + 4];
+    uint16_t count = wifi_sta_scan_sched_get_history (history, CONFIG_WIFI_STA_SCAN_SCHED_HISTORY + 4);
+    HOST_CHECK (count == CONFIG_WIFI_STA_SCAN_SCHED_HISTORY);
+    // Latest decisions, oldest first
+    for (uint16_t i = 0; i < count; i++){
+        HOST_CHECK (history[i].period_ms == periods[12 - count + i]);
+        HOST_CHECK (i == 0 || history[i].timestamp_us > history[i - 1].timestamp_us);
+    }
+    HOST_CHECK (history[count - 2].reason == WIFI_STA_SCAN_SCHED_DISCONNECT);
+    HOST_CHECK (history[count - 4].reason == WIFI_STA_SCAN_SCHED_CHURN && history[count - 4].disappeared == 8);
+
+    wifi_sta_scan_sched_entry_t latest[3];
+    HOST_CHECK (wifi_sta_scan_sched_get_history (latest, 3) == 3);
+    HOST_CHECK (memcmp (latest, &history[count - 3], sizeof(latest)) == 0);
+}
+
+static void test_overflow (void)
+{
+    wifi_ap_record_t scan[MAX_SCAN];
+    wifi_ap_record_t reordered[MAX_SCAN];
+    wifi_sta_scan_sched_init (MIN_MS, MAX_MS);
+    // 40 APs for 16 remembered, with RSSI ties at the cutoff
+    uint16_t num = make_scan (scan, 0, 40);
+    for (uint16_t i = 10; i < 30; i++){
+        scan[i].rssi = -55;
+    }
+    wifi_sta_scan_sched_update (scan, num);
+    HOST_CHECK (last_entry ().ap_num == 40);
+
+    // Same APs in another order: nothing changed
+    for (uint16_t i = 0; i < num; i++){
+        reordered[i] = scan[(i * 7) % num];
+    }
+    HOST_CHECK (wifi_sta_scan_sched_update (reordered, num) == 2 * MIN_MS);
+    wifi_sta_scan_sched_entry_t entry = last_entry ();
+    HOST_CHECK (entry.reason == WIFI_STA_SCAN_SCHED_STABLE && entry.churn == 0);
+    HOST_CHECK (entry.appeared == 0 && entry.disappeared == 0);
+
+    // The weakest APs left out vanish: not churn either
+    HOST_CHECK (wifi_sta_scan_sched_update (scan, 20) == 4 * MIN_MS);
+    entry = last_entry ();
+    HOST_CHECK (entry.churn == 0 && entry.appeared == 0 && entry.disappeared == 0);
+
+    // One remembered AP gone: the next one takes its place without counting as new
+    HOST_CHECK (wifi_sta_scan_sched_update (scan + 1, 19) == 8 * MIN_MS);
+    entry = last_entry ();
+    HOST_CHECK (entry.appeared == 0 && entry.disappeared == 1 && entry.churn == 6);
+
+    // A strong newcomer is seen
+    make_ap (&scan[20], 100, -30);
+    wifi_sta_scan_sched_update (scan + 1, 20);
+    entry = last_entry ();
+    HOST_CHECK (entry.appeared == 1 && entry.disappeared == 0);
+}
+
+static void test_rssi_floor (void)
+{
+    wifi_ap_record_t scan[MAX_SCAN];
+    wifi_sta_scan_sched_init (MIN_MS, MAX_MS);
+    uint16_t num = make_scan (scan, 0, 8);
+    wifi_sta_scan_sched_update (scan, num);
+    // APs below the floor come and go
+    for (uint16_t i = 0; i < 4; i++){
+        make_ap (&scan[num + i], 200 + i, CONFIG_WIFI_STA_SCAN_SCHED_RSSI_FLOOR - 1);
+    }
+    HOST_CHECK (wifi_sta_scan_sched_update (scan, num + 4) == 2 * MIN_MS);
+    wifi_sta_scan_sched_entry_t entry = last_entry ();
+    HOST_CHECK (entry.ap_num == 8 && entry.appeared == 0 && entry.churn == 0);
+}
+
+int main (void)
+{
+    test_init();
+    test_stable_stretches();
+    test_appear_disappear();
+    test_rssi_swing();
+    test_disconnect();
+    test_history();
+    test_overflow();
+    test_rssi_floor();
+    return host_test_result();
+}
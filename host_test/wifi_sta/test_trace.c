@@ -0,0 +1,328 @@
+/**
+ * @brief Host test of the wifi_sta trace ring writer
+ * Built once per trace level. Records are written with the macros, dumped with
+ * wifi_sta_trace_dump_uart and wifi_sta_trace_dump_flash, then checked both as raw
+ * records and through tools/wifi_sta_trace_decode.py (arguments: python, decoder).
+ */
+#include "wifi_sta_trace.h"
+#include "host_test.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DUMP_MAX    (sizeof(wifi_sta_trace_header_t) + CONFIG_WIFI_STA_TRACE_BUF_RECORDS * sizeof(wifi_sta_trace_record_t))
+
+static int64_t s_now_us = 0;
+static uint8_t s_flash[4096];
+static const esp_partition_t s_partition = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .subtype = ESP_PARTITION_SUBTYPE_ANY,
+    .size = sizeof(s_flash),
+    .erase_size = 1024,
+    .label = "trace",
+};
+static const char *s_python = NULL;
+static const char *s_decoder = NULL;
+static int s_evaluated = 0;
+
+/******************************
+ * ESP-IDF stand-ins
+ */
+
+int64_t esp_timer_get_time(void)
+{
+    s_now_us += 1000;
+    return s_now_us;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    return (strcmp (label, s_partition.label) == 0) ? &s_partition : NULL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (offset % partition->erase_size != 0 || size % partition->erase_size != 0 || offset + size > partition->size){
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset (s_flash + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    if (dst_offset + size > partition->size){
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy (s_flash + dst_offset, src, size);
+    return ESP_OK;
+}
+
+/******************************
+ * Helpers
+ */
+
+/**
+ * @brief Argument with a side effect, to check that disabled levels do not evaluate it
+ */
+static uint32_t evaluated (uint32_t value)
+{
+    s_evaluated++;
+    return value;
+}
+
+/******************************
+ * Tests
+ */
+
+#if CONFIG_WIFI_STA_TRACE_LEVEL > WIFI_STA_TRACE_LEVEL_NONE
+
+static char s_path[] = "/tmp/wifi_sta_trace_XXXXXX";
+static uint8_t s_dump[DUMP_MAX];
+static char s_decoded[16384];
+
+/**
+ * @brief Run wifi_sta_trace_dump_uart with stdout redirected to path
+ */
+static esp_err_t dump_uart_to (const char *path)
+{
+    fflush (stdout);
+    int saved = dup (STDOUT_FILENO);
+    FILE *file = fopen (path, "w");
+    if (saved < 0 || file == NULL){
+        return ESP_FAIL;
+    }
+    dup2 (fileno (file), STDOUT_FILENO);
+    esp_err_t esp_ret = wifi_sta_trace_dump_uart();
+    fflush (stdout);
+    dup2 (saved, STDOUT_FILENO);
+    close (saved);
+    fclose (file);
+    return esp_ret;
+}
+
+/**
+ * @brief Binary dump back from the "WSTRACE <hex>" lines of a console log
+ */
+static size_t load_uart_dump (const char *path, uint8_t *data, size_t max_len)
+{
+    FILE *file = fopen (path, "r");
+    char line[256];
+    size_t len = 0;
+    while (file != NULL && fgets (line, sizeof(line), file) != NULL){
+        if (strncmp (line, "WSTRACE ", 8) != 0){
+            continue;
+        }
+        for (const char *hex = line + 8; hex[0] != '\0' && hex[0] != '\n' && len < max_len; hex += 2){
+            unsigned byte;
+            sscanf (hex, "%2x", &byte);
+            data[len++] = (uint8_t) byte;
+        }
+    }
+    if (file != NULL){
+        fclose (file);
+    }
+    return len;
+}
+
+/**
+ * @brief Decoder output for a dump file, empty if the decoder is not available or fails
+ */
+static void decode (const char *path, char *out, size_t max_len)
+{
+    out[0] = '\0';
+    if (s_python == NULL){
+        return;
+    }
+    char command[512];
+    snprintf (command, sizeof(command), "%s %s %s", s_python, s_decoder, path);
+    FILE *pipe = popen (command, "r");
+    HOST_CHECK (pipe != NULL);
+    if (pipe == NULL){
+        return;
+    }
+    size_t len = fread (out, 1, max_len - 1, pipe);
+    out[len] = '\0';
+    HOST_CHECK (pclose (pipe) == 0);
+}
+
+static const wifi_sta_trace_record_t *dump_record (const uint8_t *dump, uint32_t index)
+{
+    return (const wifi_sta_trace_record_t*) (dump + sizeof(wifi_sta_trace_header_t)) + index;
+}
+
+/**
+ * @brief Decoded timeline has a line for this event
+ */
+static bool decoded_has (const char *name, const char *details)
+{
+    char line[256];
+    snprintf (line, sizeof(line), "  %-28s %s\n", name, details);
+    return strstr (s_decoded, line) != NULL;
+}
+
+
+/**
+ * @brief Ring wraps: the newest records are kept, oldest first, overwrites are counted
+ */
+static void test_wraparound (void)
+{
+    const uint32_t written = CONFIG_WIFI_STA_TRACE_BUF_RECORDS + 8;
+    wifi_sta_trace_clear();
+    for (uint32_t i = 0; i < written; i++){
+        wifi_sta_trace_write (WIFI_STA_TRACE_LEVEL_INFO, WIFI_STA_TRACE_SCAN_NUM, i, 0);
+    }
+    HOST_CHECK (dump_uart_to (s_path) == ESP_OK);
+    size_t len = load_uart_dump (s_path, s_dump, sizeof(s_dump));
+    HOST_CHECK (len == DUMP_MAX);
+
+    const wifi_sta_trace_header_t *header = (const wifi_sta_trace_header_t*) s_dump;
+    HOST_CHECK (header->magic == WIFI_STA_TRACE_MAGIC);
+    HOST_CHECK (header->version == WIFI_STA_TRACE_VERSION);
+    HOST_CHECK (header->record_size == sizeof(wifi_sta_trace_record_t));
+    HOST_CHECK (header->record_count == CONFIG_WIFI_STA_TRACE_BUF_RECORDS);
+    HOST_CHECK (header->dropped == written - CONFIG_WIFI_STA_TRACE_BUF_RECORDS);
+    for (uint32_t i = 0; i < CONFIG_WIFI_STA_TRACE_BUF_RECORDS && len == DUMP_MAX; i++){
+        const wifi_sta_trace_record_t *record = dump_record (s_dump, i);
+        HOST_CHECK (record->arg0 == i + 8);
+        HOST_CHECK (record->event_id == WIFI_STA_TRACE_SCAN_NUM);
+        HOST_CHECK (record->level == WIFI_STA_TRACE_LEVEL_INFO);
+        HOST_CHECK (i == 0 || record->timestamp_us > dump_record (s_dump, i - 1)->timestamp_us);
+    }
+
+    decode (s_path, s_decoded, sizeof(s_decoded));
+    if (s_python != NULL){
+        HOST_CHECK (strstr (s_decoded, "32 records, 8 dropped\n") != NULL);
+        HOST_CHECK (decoded_has ("WIFI_STA_SCAN_NUM", "ap_num=8"));
+        HOST_CHECK (decoded_has ("WIFI_STA_SCAN_NUM", "ap_num=39"));
+        HOST_CHECK (strstr (s_decoded, "ap_num=7\n") == NULL);
+    }
+}
+
+/**
+ * @brief AP events carry the full BSSID and SSID in follow-up records
+ */
+static void test_ap_identity (void)
+{
+    const uint8_t bssid[6] = { 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0x01 };
+    const uint8_t ssid[32] = "Home-Net 5G";
+    // 32 bytes, not NUL terminated, as in wifi_event_sta_connected_t
+    uint8_t long_ssid[32];
+    memset (long_ssid, 'x', sizeof(long_ssid));
+    long_ssid[0] = 0xC3;    // Not valid UTF-8 on its own
+
+    wifi_sta_trace_clear();
+    wifi_sta_trace_write_ap (WIFI_STA_TRACE_LEVEL_INFO, WIFI_STA_TRACE_CONNECTED, 6 | (3 << 8) | (1 << 16), bssid, ssid, sizeof(ssid));
+    wifi_sta_trace_write_ap (WIFI_STA_TRACE_LEVEL_VERBOSE, WIFI_STA_TRACE_SCAN_AP,
+                             1 | (11 << 8) | (4 << 16) | ((uint32_t)(uint8_t)-70 << 24), bssid, long_ssid, sizeof(long_ssid));
+    wifi_sta_trace_write (WIFI_STA_TRACE_LEVEL_INFO, WIFI_STA_TRACE_GOT_IP, 0x0101A8C0, 0x0101A8C0);
+    HOST_CHECK (dump_uart_to (s_path) == ESP_OK);
+    size_t len = load_uart_dump (s_path, s_dump, sizeof(s_dump));
+    const wifi_sta_trace_header_t *header = (const wifi_sta_trace_header_t*) s_dump;
+    // CONNECTED + ID + 2 SSID, SCAN_AP + ID + 4 SSID, GOT_IP
+    HOST_CHECK (header->record_count == 4 + 6 + 1);
+    HOST_CHECK (len == sizeof(*header) + header->record_count * sizeof(wifi_sta_trace_record_t));
+    if (len >= sizeof(*header) + 2 * sizeof(wifi_sta_trace_record_t)){
+        const wifi_sta_trace_record_t *id = dump_record (s_dump, 1);
+        HOST_CHECK (id->event_id == WIFI_STA_TRACE_AP_ID);
+        HOST_CHECK (id->arg0 == (0xaa | (0xbb << 8) | (11 << 16)));
+    }
+
+    decode (s_path, s_decoded, sizeof(s_decoded));
+    if (s_python != NULL){
+        HOST_CHECK (decoded_has ("WIFI_STA_CONNECTED",
+                                 "channel=6 authmode=3 aid=1 bssid=aa:bb:cc:dd:ee:01 ssid=\"Home-Net 5G\""));
+        HOST_CHECK (decoded_has ("WIFI_STA_SCAN_AP", "index=1 channel=11 authmode=4 rssi=-70 "
+                                 "bssid=aa:bb:cc:dd:ee:01 ssid=\"\\xc3xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\""));
+        // Follow-up records are folded into their event
+        HOST_CHECK (strstr (s_decoded, "WIFI_STA_AP_") == NULL);
+        HOST_CHECK (strstr (s_decoded, "WIFI_STA_GOT_IP") != NULL);
+    }
+
+    // Ring wrapped inside an AP event: the orphan follow-ups are printed on their own
+    for (int i = 0; i < CONFIG_WIFI_STA_TRACE_BUF_RECORDS - 6; i++){
+        wifi_sta_trace_write (WIFI_STA_TRACE_LEVEL_INFO, WIFI_STA_TRACE_SCAN_NUM, i, 0);
+    }
+    HOST_CHECK (dump_uart_to (s_path) == ESP_OK);
+    decode (s_path, s_decoded, sizeof(s_decoded));
+    if (s_python != NULL){
+        HOST_CHECK (strstr (s_decoded, "32 records, 5 dropped\n") != NULL);
+        HOST_CHECK (decoded_has ("WIFI_STA_AP_SSID", "ssid_part=\"xxxxxxxx\""));
+        HOST_CHECK (strstr (s_decoded, "WIFI_STA_CONNECTED") == NULL);
+    }
+}
+
+/**
+ * @brief The flash dump holds the same bytes as the console dump
+ */
+static void test_dump_flash (void)
+{
+    wifi_sta_trace_clear();
+    for (uint32_t i = 0; i < CONFIG_WIFI_STA_TRACE_BUF_RECORDS + 3; i++){
+        WIFI_STA_TRACE_E (WIFI_STA_TRACE_RECONNECT, i, ESP_FAIL);
+    }
+    HOST_CHECK (dump_uart_to (s_path) == ESP_OK);
+    size_t len = load_uart_dump (s_path, s_dump, sizeof(s_dump));
+    memset (s_flash, 0, sizeof(s_flash));
+    HOST_CHECK (wifi_sta_trace_dump_flash() == ESP_OK);
+    HOST_CHECK (len == DUMP_MAX && memcmp (s_flash, s_dump, len) == 0);
+    // Erased up to the end of the erase block, nothing after it
+    HOST_CHECK (s_flash[len] == 0xFF && s_flash[s_partition.erase_size - 1] == 0xFF);
+    HOST_CHECK (s_flash[s_partition.erase_size] == 0);
+
+    FILE *file = fopen (s_path, "wb");
+    fwrite (s_flash, 1, sizeof(s_flash), file);
+    fclose (file);
+    decode (s_path, s_decoded, sizeof(s_decoded));
+    if (s_python != NULL){
+        HOST_CHECK (strstr (s_decoded, "32 records, 3 dropped\n") != NULL);
+        HOST_CHECK (decoded_has ("WIFI_STA_RECONNECT", "count=34 err=-1"));
+    }
+}
+
+#endif // CONFIG_WIFI_STA_TRACE_LEVEL
+
+/**
+ * @brief Levels above CONFIG_WIFI_STA_TRACE_LEVEL compile to nothing
+ * The other tests call the writer directly so they run at every enabled level.
+ */
+static void test_levels (void)
+{
+    const uint8_t bssid[6] = { 0 };
+    const uint8_t ssid[32] = "net";
+    s_evaluated = 0;
+    WIFI_STA_TRACE_E (WIFI_STA_TRACE_RECONNECT, evaluated (1), 0);
+    WIFI_STA_TRACE_I (WIFI_STA_TRACE_SCAN_NUM, evaluated (1), 0);
+    WIFI_STA_TRACE_V (WIFI_STA_TRACE_NETMASK, evaluated (1), 0);
+    WIFI_STA_TRACE_AP_I (WIFI_STA_TRACE_CONNECTED, evaluated (1), bssid, ssid);
+    WIFI_STA_TRACE_AP_V (WIFI_STA_TRACE_SCAN_AP, evaluated (1), bssid, ssid);
+    int expected = (CONFIG_WIFI_STA_TRACE_LEVEL >= WIFI_STA_TRACE_LEVEL_ERROR) +
+                   2 * (CONFIG_WIFI_STA_TRACE_LEVEL >= WIFI_STA_TRACE_LEVEL_INFO) +
+                   2 * (CONFIG_WIFI_STA_TRACE_LEVEL >= WIFI_STA_TRACE_LEVEL_VERBOSE);
+    HOST_CHECK (s_evaluated == expected);
+#if CONFIG_WIFI_STA_TRACE_LEVEL == WIFI_STA_TRACE_LEVEL_NONE
+    HOST_CHECK (wifi_sta_trace_dump_uart() == ESP_ERR_NOT_SUPPORTED);
+    HOST_CHECK (wifi_sta_trace_dump_flash() == ESP_ERR_NOT_SUPPORTED);
+#endif
+}
+
+int main (int argc, char **argv)
+{
+    if (argc >= 3){
+        s_python = argv[1];
+        s_decoder = argv[2];
+    }
+    test_levels();
+#if CONFIG_WIFI_STA_TRACE_LEVEL > WIFI_STA_TRACE_LEVEL_NONE
+    int fd = mkstemp (s_path);
+    HOST_CHECK (fd >= 0);
+    close (fd);
+    test_wraparound();
+    test_ap_identity();
+    test_dump_flash();
+    unlink (s_path);
+#endif
+    return host_test_result();
+}
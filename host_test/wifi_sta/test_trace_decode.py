@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""Host test of tools/wifi_sta_trace_decode.py timestamp unwrapping."""
+import importlib.util
+import io
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TOOL = os.path.join(HERE, "..", "..", "components", "wifi_sta", "tools", "wifi_sta_trace_decode.py")
+
+spec = importlib.util.spec_from_file_location("wifi_sta_trace_decode", TOOL)
+decoder = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(decoder)
+
+
+def dump(timestamps):
+    data = decoder.HEADER.pack(decoder.MAGIC, decoder.VERSION, decoder.RECORD.size, len(timestamps), 0)
+    for ts in timestamps:
+        data += decoder.RECORD.pack(ts, 0, 2, 0x0104, 0, 0)   # WIFI_EVENT_STA_CONNECTED
+    return data
+
+
+def offsets(timestamps):
+    """Relative times (us) printed for each record."""
+    out = io.StringIO()
+    decoder.decode(dump(timestamps), out)
+    lines = out.getvalue().splitlines()[1:]
+    return [round(float(re.search(r"\+\s*(-?[\d.]+)", line).group(1)) * 1e6) for line in lines]
+
+
+def main():
+    failures = 0
+    cases = [
+        # Records written from two cores may be slightly out of order
+        ([1001, 1000, 2000], [0, -1, 999]),
+        # Real wrap of the 32-bit timestamp
+        ([0xFFFFFF00, 0x00000100, 0x00000200], [0, 0x200, 0x300]),
+        # Out of order right across the wrap
+        ([0xFFFFFFF0, 0x00000010, 0xFFFFFFFF, 0x00000020], [0, 0x20, 0x0F, 0x30]),
+    ]
+    for timestamps, expected in cases:
+        got = offsets(timestamps)
+        if got != expected:
+            print("timestamps %s: got %s, expected %s" % (timestamps, got, expected))
+            failures += 1
+    if failures:
+        sys.exit(1)
+    print("PASS")
+
+
+if __name__ == "__main__":
+    main()